@@ -0,0 +1,97 @@
+#include <osg/Array>
+
+#include <vsg/all.h>
+
+#include "GeometryUtils.h"
+
+#include <chrono>
+#include <iostream>
+
+// the element by element conversion that osg2vsg used before the bulk conversion, kept here as the baseline to compare against
+template<class OutArray, class InArray>
+vsg::ref_ptr<OutArray> convertPerElement(const InArray* inarray, uint32_t bindOverallPaddingCount)
+{
+    using out_value_type = typename OutArray::value_type;
+
+    uint32_t count = inarray->size();
+    uint32_t targetSize = std::max(count, bindOverallPaddingCount);
+
+    vsg::ref_ptr<OutArray> outarray(new OutArray(targetSize));
+    uint32_t i = 0;
+    for (; i < count; ++i)
+    {
+        const auto& in_value = inarray->at(i);
+        out_value_type out_value;
+        for (uint32_t c = 0; c < out_value.size(); ++c) out_value[c] = static_cast<typename out_value_type::value_type>(in_value[c]);
+        outarray->at(i) = out_value;
+    }
+
+    if (i < bindOverallPaddingCount)
+    {
+        auto last = outarray->at(count - 1);
+        for (; i < bindOverallPaddingCount; ++i)
+        {
+            outarray->at(i) = last;
+        }
+    }
+
+    return outarray;
+}
+
+template<class InArray>
+osg::ref_ptr<InArray> createArray(uint32_t numElements)
+{
+    osg::ref_ptr<InArray> array = new InArray(numElements);
+    for (uint32_t i = 0; i < numElements; ++i)
+    {
+        auto& value = (*array)[i];
+        for (uint32_t c = 0; c < InArray::ElementDataType::num_components; ++c) value[c] = static_cast<typename InArray::ElementDataType::value_type>(i * 4 + c);
+    }
+    return array;
+}
+
+template<class OutArray, class InArray>
+void benchmark(const std::string& name, const InArray* inarray, uint32_t bindOverallPaddingCount, uint32_t numRepeats)
+{
+    auto outputBytes = double(std::max(uint32_t(inarray->size()), bindOverallPaddingCount) * sizeof(typename OutArray::value_type)) * double(numRepeats);
+
+    auto time = [&](auto convert) {
+        size_t checksum = 0;
+        auto start = vsg::clock::now();
+        for (uint32_t i = 0; i < numRepeats; ++i)
+        {
+            auto outarray = convert();
+            checksum += outarray->valueCount();
+        }
+        double duration = std::chrono::duration<double, std::chrono::seconds::period>(vsg::clock::now() - start).count();
+        if (checksum == 0) std::cout << "    no output" << std::endl;
+        return duration;
+    };
+
+    double perElement = time([&]() { return convertPerElement<OutArray>(inarray, bindOverallPaddingCount); });
+    double bulk = time([&]() { return osg2vsg::convertToVsg(inarray, bindOverallPaddingCount); });
+
+    std::cout << name << std::endl;
+    std::cout << "    per element : " << perElement * 1000.0 / numRepeats << "ms, " << outputBytes / perElement / 1.0e9 << " GB/s" << std::endl;
+    std::cout << "    bulk        : " << bulk * 1000.0 / numRepeats << "ms, " << outputBytes / bulk / 1.0e9 << " GB/s" << std::endl;
+    std::cout << "    speed up    : " << perElement / bulk << "x" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    vsg::CommandLine arguments(&argc, argv);
+
+    uint32_t numVertices = arguments.value(4000000, "-n");
+    uint32_t numRepeats = arguments.value(10, "-r");
+
+    std::cout << "Converting " << numVertices << " elements, " << numRepeats << " repeats" << std::endl;
+
+    benchmark<vsg::vec2Array>("Vec2Array", createArray<osg::Vec2Array>(numVertices).get(), 0, numRepeats);
+    benchmark<vsg::vec3Array>("Vec3Array", createArray<osg::Vec3Array>(numVertices).get(), 0, numRepeats);
+    benchmark<vsg::vec4Array>("Vec4Array", createArray<osg::Vec4Array>(numVertices).get(), 0, numRepeats);
+    benchmark<vsg::vec3Array>("Vec3dArray", createArray<osg::Vec3dArray>(numVertices).get(), 0, numRepeats);
+    benchmark<vsg::vec4Array>("Vec4dArray", createArray<osg::Vec4dArray>(numVertices).get(), 0, numRepeats);
+    benchmark<vsg::vec4Array>("Vec4Array BIND_OVERALL padding", createArray<osg::Vec4Array>(1).get(), numVertices, numRepeats);
+
+    return 0;
+}
@@ -1,5 +1,5 @@
 #version 450
-#pragma import_defines ( VSG_NORMAL, VSG_TANGENT, VSG_COLOR, VSG_TEXCOORD0, VSG_LIGHTING, VSG_NORMAL_MAP, VSG_BILLBOARD, VSG_TRANSLATE )
+#pragma import_defines ( VSG_NORMAL, VSG_TANGENT, VSG_COLOR, VSG_TEXCOORD0, VSG_LIGHTING, VSG_NORMAL_MAP, VSG_BILLBOARD, VSG_TRANSLATE, VSG_OCTAHEDRAL, VSG_INSTANCE_MATRIX )
 #extension GL_ARB_separate_shader_objects : enable
 layout(push_constant) uniform PushConstants {
     mat4 projection;
@@ -8,7 +8,11 @@ layout(push_constant) uniform PushConstants {
 } pc;
 layout(location = 0) in vec3 osg_Vertex;
 #ifdef VSG_NORMAL
+#ifdef VSG_OCTAHEDRAL
+layout(location = 1) in vec2 osg_Normal;
+#else
 layout(location = 1) in vec3 osg_Normal;
+#endif
 layout(location = 1) out vec3 normalDir;
 #endif
 #ifdef VSG_TANGENT
@@ -31,12 +35,30 @@ layout(location = 7) in vec3 translate;
 #endif
 
 
+#ifdef VSG_INSTANCE_MATRIX
+layout(location = 8) in mat4 instanceMatrix;
+#endif
+
 out gl_PerVertex{ vec4 gl_Position; };
 
+#ifdef VSG_OCTAHEDRAL
+// decode a unit vector stored as octahedral coordinates
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+#endif
+
 void main()
 {
     mat4 modelView = pc.modelView;
 
+#ifdef VSG_INSTANCE_MATRIX
+    modelView = modelView * instanceMatrix;
+#endif
+
 #ifdef VSG_TRANSLATE
     mat4 translate_mat = mat4(1.0, 0.0, 0.0, 0.0,
                               0.0, 1.0, 0.0, 0.0,
@@ -72,13 +94,22 @@ void main()
     texCoord0 = osg_MultiTexCoord0.st;
 #endif
 #ifdef VSG_NORMAL
-    vec3 n = (modelView * vec4(osg_Normal, 0.0)).xyz;
+#ifdef VSG_OCTAHEDRAL
+    vec3 normal = octDecode(osg_Normal);
+#else
+    vec3 normal = osg_Normal;
+#endif
+    vec3 n = (modelView * vec4(normal, 0.0)).xyz;
     normalDir = n;
 #endif
 #ifdef VSG_LIGHTING
     vec4 lpos = /*osg_LightSource.position*/ vec4(0.0, 0.25, 1.0, 0.0);
 #ifdef VSG_NORMAL_MAP
+#ifdef VSG_OCTAHEDRAL
+    vec3 t = (modelView * vec4(octDecode(osg_Tangent.xy), 0.0)).xyz;
+#else
     vec3 t = (modelView * vec4(osg_Tangent.xyz, 0.0)).xyz;
+#endif
     vec3 b = cross(n, t);
     vec3 dir = -vec3(modelView * vec4(osg_Vertex, 1.0));
     viewDir.x = dot(dir, t);
@@ -26,10 +26,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <vsg/io/ReaderWriter.h>
 #include <osg2vsg/Export.h>
 
+#include <mutex>
+
 namespace osg2vsg
 {
     // forward declare
     class PipelineCache;
+    class TaskPool;
 
     /// optional OSG ReaderWriter
     class OSG2VSG_DECLSPEC OSG : public vsg::Inherit<vsg::ReaderWriter, OSG>
@@ -45,6 +48,16 @@ namespace osg2vsg
         static constexpr const char* original_converter = "original_converter";   // select early osg2vsg implementation
         static constexpr const char* read_build_options = "read_build_options";   // read build options from specified file
         static constexpr const char* write_build_options = "write_build_options"; // write build options to specified file
+        static constexpr const char* read_pipeline_manifest = "read_pipeline_manifest";   // prebuild the pipelines listed in the specified manifest file before the first conversion
+        static constexpr const char* write_pipeline_manifest = "write_pipeline_manifest"; // write the pipelines created so far to the specified manifest file after each conversion
+        static constexpr const char* zero_copy_arrays = "zero_copy_arrays";               // vsg arrays share the storage of the osg arrays rather than copying them
+        static constexpr const char* pipeline_cache_capacity = "pipeline_cache_capacity"; // uint32_t maximum number of unreferenced pipelines to retain, least recently used are evicted first
+        static constexpr const char* share_identical_data = "share_identical_data";       // share byte identical arrays and geometries converted from separate osg objects
+        static constexpr const char* collect_statistics = "collect_statistics";           // gather conversion statistics and report them with vsg::debug
+
+        // vsg::Options::setObject(str, object) supported options:
+        static constexpr const char* pipeline_cache = "pipeline_cache"; // osg2vsg::PipelineCache to use in place of the reader's own, shared across reads
+        static constexpr const char* task_pool = "task_pool";           // osg2vsg::TaskPool to use in place of the reader's own, shared across reads
 
         bool readOptions(vsg::Options& options, vsg::CommandLine& arguments) const override;
 
@@ -52,6 +65,10 @@ namespace osg2vsg
 
         vsg::ref_ptr<PipelineCache> pipelineCache;
 
+        // created on the first conversion that needs one and reused by later reads, so paged databases don't start and join worker threads for every tile
+        mutable std::mutex taskPoolMutex;
+        mutable vsg::ref_ptr<TaskPool> taskPool;
+
         ~OSG();
     };
 
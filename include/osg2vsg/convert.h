@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 </editor-fold> */
 
+#include <vsg/core/Array.h>
 #include <vsg/io/ReaderWriter.h>
 
 #include <osg/Node>
@@ -59,6 +60,35 @@ namespace osg2vsg
         return new_array;
     }
 
+    /// vsg::Array that wraps the storage of an osg::Array rather than copying it, keeping the osg::Array referenced until the vsg::Array is released.
+    /// className() is that of vsg::Array<T> so it is written to and read from file as a regular vsg::Array<T>.
+    template<typename T>
+    class AdoptedArray : public vsg::Array<T>
+    {
+    public:
+        AdoptedArray(const osg::Array& array, vsg::Data::Properties properties) :
+            vsg::Array<T>(array.getNumElements(), static_cast<T*>(const_cast<void*>(array.getDataPointer())), properties),
+            osgArray(&array)
+        {
+        }
+
+        osg::ref_ptr<const osg::Array> osgArray;
+
+    protected:
+        virtual ~AdoptedArray() {}
+    };
+
+    /// create a vsg array that shares the osg array's storage, avoiding the copy made by convert<T>(). Modifying either array's data modifies the other's.
+    template<class T>
+    vsg::ref_ptr<T> adopt(const osg::Array& array)
+    {
+        if (array.getNumElements() == 0 || array.getTotalDataSize() != array.getNumElements() * sizeof(typename T::value_type)) return convert<T>(array);
+
+        vsg::Data::Properties properties;
+        properties.allocatorType = vsg::ALLOCATOR_TYPE_NO_DELETE;
+        return vsg::ref_ptr<T>(new AdoptedArray<typename T::value_type>(array, properties));
+    }
+
     OSG2VSG_DECLSPEC extern vsg::ref_ptr<vsg::Data> convert(const osg::Array& array, vsg::ref_ptr<const vsg::Options> options = {});
     OSG2VSG_DECLSPEC extern vsg::ref_ptr<vsg::Data> convert(const osg::Image& image, vsg::ref_ptr<const vsg::Options> options = {});
     OSG2VSG_DECLSPEC extern vsg::ref_ptr<vsg::Node> convert(const osg::Node& node, vsg::ref_ptr<const vsg::Options> options = {});
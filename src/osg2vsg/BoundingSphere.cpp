@@ -0,0 +1,241 @@
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include "BoundingSphere.h"
+#include "GeometryUtils.h"
+
+using namespace osg2vsg;
+
+vsg::dsphere osg2vsg::computeBoundingSphere(const std::vector<vsg::dvec3>& points)
+{
+    if (points.empty()) return vsg::dsphere(0.0, 0.0, 0.0, -1.0);
+
+    static const vsg::dvec3 directions[] = {
+        {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0},
+        {1.0, 1.0, 1.0}, {1.0, 1.0, -1.0}, {1.0, -1.0, 1.0}, {1.0, -1.0, -1.0},
+        {1.0, 1.0, 0.0}, {1.0, -1.0, 0.0}, {1.0, 0.0, 1.0}, {1.0, 0.0, -1.0}, {0.0, 1.0, 1.0}, {0.0, 1.0, -1.0}};
+    constexpr size_t numDirections = sizeof(directions) / sizeof(directions[0]);
+
+    // extremal points along each direction, the inner loop over the directions is kept branch free so it vectorizes
+    double minProjection[numDirections];
+    double maxProjection[numDirections];
+    size_t minPoint[numDirections] = {};
+    size_t maxPoint[numDirections] = {};
+    for (size_t d = 0; d < numDirections; ++d) minProjection[d] = maxProjection[d] = vsg::dot(points[0], directions[d]);
+
+    for (size_t i = 1; i < points.size(); ++i)
+    {
+        const auto& p = points[i];
+        for (size_t d = 0; d < numDirections; ++d)
+        {
+            double projection = p.x * directions[d].x + p.y * directions[d].y + p.z * directions[d].z;
+            minPoint[d] = (projection < minProjection[d]) ? i : minPoint[d];
+            minProjection[d] = std::min(projection, minProjection[d]);
+            maxPoint[d] = (projection > maxProjection[d]) ? i : maxPoint[d];
+            maxProjection[d] = std::max(projection, maxProjection[d]);
+        }
+    }
+
+    // seed the sphere with the most distant pair of extremal points
+    size_t seedDirection = 0;
+    double maxDistance2 = -1.0;
+    for (size_t d = 0; d < numDirections; ++d)
+    {
+        double distance2 = vsg::length2(points[maxPoint[d]] - points[minPoint[d]]);
+        if (distance2 > maxDistance2)
+        {
+            maxDistance2 = distance2;
+            seedDirection = d;
+        }
+    }
+
+    vsg::dvec3 center = (points[minPoint[seedDirection]] + points[maxPoint[seedDirection]]) * 0.5;
+    double radius = std::sqrt(maxDistance2) * 0.5;
+
+    // grow the sphere towards each point outside it just enough to enclose it
+    double radius2 = radius * radius;
+    for (const auto& p : points)
+    {
+        double distance2 = vsg::length2(p - center);
+        if (distance2 > radius2)
+        {
+            double distance = std::sqrt(distance2);
+            double newRadius = (radius + distance) * 0.5;
+            center += (p - center) * ((newRadius - radius) / distance);
+            radius = newRadius;
+            radius2 = radius * radius;
+        }
+    }
+
+    return vsg::dsphere(center, radius);
+}
+
+vsg::dsphere osg2vsg::enclosingSphere(const std::vector<vsg::dsphere>& spheres)
+{
+    vsg::dsphere result(0.0, 0.0, 0.0, -1.0);
+    for (const auto& sphere : spheres)
+    {
+        if (!sphere.valid()) continue;
+        if (!result.valid())
+        {
+            result = sphere;
+            continue;
+        }
+
+        double distance = vsg::length(sphere.center - result.center);
+        if (distance + sphere.radius <= result.radius) continue;
+        if (distance + result.radius <= sphere.radius)
+        {
+            result = sphere;
+            continue;
+        }
+
+        double newRadius = (distance + result.radius + sphere.radius) * 0.5;
+        result.center += (sphere.center - result.center) * ((newRadius - result.radius) / distance);
+        result.radius = newRadius;
+    }
+    return result;
+}
+
+CollectVertices::CollectVertices()
+{
+    matrixStack.push_back(vsg::dmat4());
+}
+
+void CollectVertices::apply(const vsg::Node& node)
+{
+    node.traverse(*this);
+}
+
+void CollectVertices::apply(const vsg::Transform& transform)
+{
+    matrixStack.push_back(transform.transform(matrixStack.back()));
+    transform.traverse(*this);
+    matrixStack.pop_back();
+}
+
+void CollectVertices::apply(const vsg::CullGroup& cullGroup)
+{
+    addBound(cullGroup.bound);
+}
+
+void CollectVertices::apply(const vsg::CullNode& cullNode)
+{
+    addBound(cullNode.bound);
+}
+
+void CollectVertices::apply(const vsg::LOD& lod)
+{
+    addBound(lod.bound);
+}
+
+void CollectVertices::apply(const vsg::PagedLOD& plod)
+{
+    // the bounds of children loaded later aren't known
+    complete = false;
+    plod.traverse(*this);
+}
+
+void CollectVertices::apply(const vsg::Geometry& geometry)
+{
+    addVertices(geometry.arrays);
+    for (auto& command : geometry.commands) command->accept(*this);
+}
+
+void CollectVertices::apply(const vsg::VertexIndexDraw& vid)
+{
+    if (vid.instanceCount > 1) complete = false;
+    addVertices(vid.arrays);
+}
+
+void CollectVertices::apply(const vsg::VertexDraw& vd)
+{
+    if (vd.instanceCount > 1) complete = false;
+    addVertices(vd.arrays);
+}
+
+void CollectVertices::apply(const vsg::BindVertexBuffers& bvb)
+{
+    addVertices(bvb.arrays);
+}
+
+void CollectVertices::apply(const vsg::Draw& draw)
+{
+    if (draw.instanceCount > 1) complete = false;
+}
+
+void CollectVertices::apply(const vsg::DrawIndexed& drawIndexed)
+{
+    if (drawIndexed.instanceCount > 1) complete = false;
+}
+
+void CollectVertices::addVertices(const vsg::BufferInfoList& arrays)
+{
+    // the converters always place the vertices first
+    auto positions = (!arrays.empty() && arrays[0]) ? arrays[0]->data.cast<vsg::vec3Array>() : vsg::ref_ptr<vsg::vec3Array>();
+    if (!positions)
+    {
+        complete = false;
+        return;
+    }
+
+    const auto& matrix = matrixStack.back();
+    vertices.reserve(vertices.size() + positions->size());
+    for (auto& p : *positions) vertices.push_back(matrix * vsg::dvec3(p));
+}
+
+void CollectVertices::addBound(const vsg::dsphere& bound)
+{
+    if (!bound.valid())
+    {
+        complete = false;
+        return;
+    }
+
+    // scale the radius by the largest axis scale of the accumulated transform
+    const auto& matrix = matrixStack.back();
+    double scale = 0.0;
+    for (int c = 0; c < 3; ++c) scale = std::max(scale, vsg::length(vsg::dvec3(matrix[c][0], matrix[c][1], matrix[c][2])));
+    bounds.push_back(vsg::dsphere(matrix * bound.center, bound.radius * scale));
+}
+
+vsg::dsphere osg2vsg::selectTightBound(const vsg::dsphere& tight, const vsg::dsphere& loose, ConversionStatistics* statistics)
+{
+    bool useTight = tight.valid() && (!loose.valid() || tight.radius < loose.radius);
+
+    if (statistics && loose.radius > 0.0)
+    {
+        ++statistics->numTightBounds;
+        statistics->tightRadiusRatioSum += static_cast<uint64_t>((useTight ? tight.radius / loose.radius : 1.0) * ConversionStatistics::ratioScale);
+    }
+
+    return useTight ? tight : loose;
+}
+
+vsg::dsphere osg2vsg::computeTightBound(const CollectVertices& collected, const vsg::dsphere& loose, ConversionStatistics* statistics)
+{
+    vsg::dsphere tight(0.0, 0.0, 0.0, -1.0);
+    if (collected.complete)
+    {
+        auto spheres = collected.bounds;
+        spheres.push_back(computeBoundingSphere(collected.vertices));
+        tight = enclosingSphere(spheres);
+    }
+    return selectTightBound(tight, loose, statistics);
+}
+
+vsg::dsphere osg2vsg::computeTightBound(const vsg::Node& node, const vsg::dsphere& loose, ConversionStatistics* statistics)
+{
+    CollectVertices collectVertices;
+    node.accept(collectVertices);
+    return computeTightBound(collectVertices, loose, statistics);
+}
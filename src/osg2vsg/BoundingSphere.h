@@ -0,0 +1,69 @@
+#pragma once
+
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include <vsg/all.h>
+
+#include <vector>
+
+namespace osg2vsg
+{
+    struct ConversionStatistics;
+
+    /// compute a bounding sphere of points close to the minimal sphere: the most distant pair of the extremal points along 13 directions seeds the sphere, EPOS-26 style,
+    /// which is then grown to enclose all the points in a single Ritter pass. Returns a sphere with a negative radius when points is empty.
+    vsg::dsphere computeBoundingSphere(const std::vector<vsg::dvec3>& points);
+
+    /// smallest sphere, found incrementally, enclosing all the spheres.
+    vsg::dsphere enclosingSphere(const std::vector<vsg::dsphere>& spheres);
+
+    /// collect the vertices of the converted draws below a node, transformed into the node's coordinate frame.
+    /// Subgraphs that already carry a bound, CullGroup, CullNode and LOD, contribute that bound instead of their vertices, so nested bounds don't recollect the same vertices at each level.
+    class CollectVertices : public vsg::ConstVisitor
+    {
+    public:
+        CollectVertices();
+
+        std::vector<vsg::dvec3> vertices;
+        std::vector<vsg::dsphere> bounds;
+        bool complete = true; // false once a draw is found whose vertices don't bound what it draws, such as an instanced draw, or a subgraph is yet to be loaded
+        std::vector<vsg::dmat4> matrixStack;
+
+        void apply(const vsg::Node& node) override;
+        void apply(const vsg::Transform& transform) override;
+        void apply(const vsg::CullGroup& cullGroup) override;
+        void apply(const vsg::CullNode& cullNode) override;
+        void apply(const vsg::LOD& lod) override;
+        void apply(const vsg::PagedLOD& plod) override;
+        void apply(const vsg::Geometry& geometry) override;
+        void apply(const vsg::VertexIndexDraw& vid) override;
+        void apply(const vsg::VertexDraw& vd) override;
+        void apply(const vsg::BindVertexBuffers& bvb) override;
+        void apply(const vsg::Draw& draw) override;
+        void apply(const vsg::DrawIndexed& drawIndexed) override;
+
+    protected:
+        void addVertices(const vsg::BufferInfoList& arrays);
+        void addBound(const vsg::dsphere& bound);
+    };
+
+    /// return tight when it is valid and smaller than loose, otherwise loose, recording the radius reduction in statistics.
+    vsg::dsphere selectTightBound(const vsg::dsphere& tight, const vsg::dsphere& loose, ConversionStatistics* statistics);
+
+    /// return the sphere enclosing the collected vertices and bounds when they bound all that is drawn and it's smaller than loose, otherwise return loose.
+    vsg::dsphere computeTightBound(const CollectVertices& collected, const vsg::dsphere& loose, ConversionStatistics* statistics);
+
+    /// return the bounding sphere of the vertices drawn below node when it's smaller than loose, otherwise return loose.
+    vsg::dsphere computeTightBound(const vsg::Node& node, const vsg::dsphere& loose, ConversionStatistics* statistics);
+
+} // namespace osg2vsg
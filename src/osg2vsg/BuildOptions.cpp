@@ -19,6 +19,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 using namespace osg2vsg;
 
 vsg::RegisterWithObjectFactoryProxy<osg2vsg::BuildOptions> s_Register_BuildOptions;
+vsg::RegisterWithObjectFactoryProxy<osg2vsg::PipelineManifest> s_Register_PipelineManifest;
 
 void BuildOptions::read(vsg::Input& input)
 {
@@ -40,6 +41,38 @@ void BuildOptions::read(vsg::Input& input)
     input.read("vertexShaderPath", vertexShaderPath);
     input.read("fragmentShaderPath", fragmentShaderPath);
     input.read("extension", extension);
+    if (input.version_greater_equal(1, 1, 11))
+    {
+        input.read("parallelConversion", parallelConversion);
+        input.read("numThreads", numThreads);
+        input.read("zeroCopyArrays", zeroCopyArrays);
+        input.read("splitLargeGeometries", splitLargeGeometries);
+        input.read("uint8Indices", uint8Indices);
+        input.read("interleavedArrays", interleavedArrays);
+        input.read("quantizeArrays", quantizeArrays);
+        input.read("shareIdenticalData", shareIdenticalData);
+        input.read("batchSmallGeometries", batchSmallGeometries);
+        input.read("maxBatchVertices", maxBatchVertices);
+        input.read("instanceRepeatedGeometries", instanceRepeatedGeometries);
+        input.read("minInstanceCount", minInstanceCount);
+        input.read("chunkLargeGeometries", chunkLargeGeometries);
+        input.read("maxChunkTriangles", maxChunkTriangles);
+        input.read("maxChunkExtent", maxChunkExtent);
+        input.read("optimizeVertexCache", optimizeVertexCache);
+        input.read("optimizeOverdraw", optimizeOverdraw);
+        input.read("overdrawThreshold", overdrawThreshold);
+        input.read("analyzeOverdraw", analyzeOverdraw);
+        input.read("generateLODs", generateLODs);
+        input.read("lodTriangleThreshold", lodTriangleThreshold);
+        input.read("numLODLevels", numLODLevels);
+        input.read("lodReduction", lodReduction);
+        input.read("lodScreenRatio", lodScreenRatio);
+        input.read("tightBounds", tightBounds);
+        input.read("batchBillboards", batchBillboards);
+        input.read("maxBillboardsPerBatch", maxBillboardsPerBatch);
+        input.read("maxBillboardBatchExtent", maxBillboardBatchExtent);
+        input.read("collectStatistics", collectStatistics);
+    }
 }
 
 void BuildOptions::write(vsg::Output& output) const
@@ -62,18 +95,205 @@ void BuildOptions::write(vsg::Output& output) const
     output.write("vertexShaderPath", vertexShaderPath);
     output.write("fragmentShaderPath", fragmentShaderPath);
     output.write("extension", extension);
+    if (output.version_greater_equal(1, 1, 11))
+    {
+        output.write("parallelConversion", parallelConversion);
+        output.write("numThreads", numThreads);
+        output.write("zeroCopyArrays", zeroCopyArrays);
+        output.write("splitLargeGeometries", splitLargeGeometries);
+        output.write("uint8Indices", uint8Indices);
+        output.write("interleavedArrays", interleavedArrays);
+        output.write("quantizeArrays", quantizeArrays);
+        output.write("shareIdenticalData", shareIdenticalData);
+        output.write("batchSmallGeometries", batchSmallGeometries);
+        output.write("maxBatchVertices", maxBatchVertices);
+        output.write("instanceRepeatedGeometries", instanceRepeatedGeometries);
+        output.write("minInstanceCount", minInstanceCount);
+        output.write("chunkLargeGeometries", chunkLargeGeometries);
+        output.write("maxChunkTriangles", maxChunkTriangles);
+        output.write("maxChunkExtent", maxChunkExtent);
+        output.write("optimizeVertexCache", optimizeVertexCache);
+        output.write("optimizeOverdraw", optimizeOverdraw);
+        output.write("overdrawThreshold", overdrawThreshold);
+        output.write("analyzeOverdraw", analyzeOverdraw);
+        output.write("generateLODs", generateLODs);
+        output.write("lodTriangleThreshold", lodTriangleThreshold);
+        output.write("numLODLevels", numLODLevels);
+        output.write("lodReduction", lodReduction);
+        output.write("lodScreenRatio", lodScreenRatio);
+        output.write("tightBounds", tightBounds);
+        output.write("batchBillboards", batchBillboards);
+        output.write("maxBillboardsPerBatch", maxBillboardsPerBatch);
+        output.write("maxBillboardBatchExtent", maxBillboardBatchExtent);
+        output.write("collectStatistics", collectStatistics);
+    }
+}
+
+void PipelineManifest::read(vsg::Input& input)
+{
+    keys.resize(input.readValue<uint32_t>("NumKeys"));
+    for (auto& key : keys)
+    {
+        input.read("shaderModeMask", std::get<0>(key));
+        input.read("geometryMask", std::get<1>(key));
+        input.read("vertexShaderPath", std::get<2>(key));
+        input.read("fragmentShaderPath", std::get<3>(key));
+    }
+}
+
+void PipelineManifest::write(vsg::Output& output) const
+{
+    output.writeValue<uint32_t>("NumKeys", keys.size());
+    for (auto& key : keys)
+    {
+        output.write("shaderModeMask", std::get<0>(key));
+        output.write("geometryMask", std::get<1>(key));
+        output.write("vertexShaderPath", std::get<2>(key));
+        output.write("fragmentShaderPath", std::get<3>(key));
+    }
+}
+
+void PipelineCache::setCapacity(size_t newCapacity)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    capacity = newCapacity;
+    evict(0);
+}
+
+PipelineCache::Statistics PipelineCache::getStatistics()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    auto result = statistics;
+    result.size = pipelineMap.size();
+    return result;
+}
+
+void PipelineCache::evict(size_t numToAdd)
+{
+    if (capacity == 0) return;
+
+    while (!pipelineMap.empty() && pipelineMap.size() + numToAdd > capacity)
+    {
+        // the cache holding the only reference means no live scene graph uses the pipeline
+        auto lru = pipelineMap.end();
+        for (auto itr = pipelineMap.begin(); itr != pipelineMap.end(); ++itr)
+        {
+            if (itr->second.bindGraphicsPipeline->referenceCount() == 1 && (lru == pipelineMap.end() || itr->second.lastUsed < lru->second.lastUsed)) lru = itr;
+        }
+        if (lru == pipelineMap.end()) return;
+
+        pipelineMap.erase(lru);
+        ++statistics.evictions;
+    }
+}
+
+vsg::ref_ptr<PipelineManifest> PipelineCache::createManifest()
+{
+    auto manifest = PipelineManifest::create();
+
+    std::lock_guard<std::mutex> guard(mutex);
+    manifest->keys.assign(createdKeys.begin(), createdKeys.end());
+
+    return manifest;
+}
+
+void PipelineCache::prebuild(const PipelineManifest& manifest, vsg::ref_ptr<const vsg::Options> options, vsg::ref_ptr<TaskPool> taskPool)
+{
+    auto build = [&](size_t i) {
+        auto& [shaderModeMask, geometryMask, vertShaderPath, fragShaderPath] = manifest.keys[i];
+        getOrCreateBindGraphicsPipeline(shaderModeMask, geometryMask, vertShaderPath, fragShaderPath, options);
+    };
+
+    if (taskPool)
+    {
+        taskPool->parallel_for(manifest.keys.size(), build);
+    }
+    else
+    {
+        for (size_t i = 0; i < manifest.keys.size(); ++i) build(i);
+    }
+}
+
+bool PipelineCache::writeManifest(const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options)
+{
+    auto manifest = createManifest();
+
+    // serialize writes so concurrent conversions don't interleave output to the same file
+    static std::mutex s_writeMutex;
+    std::lock_guard<std::mutex> guard(s_writeMutex);
+
+    if (manifest->keys.size() <= numManifestKeys) return false;
+
+    if (!vsg::write(manifest, filename, options)) return false;
+
+    numManifestKeys = manifest->keys.size();
+    return true;
 }
 
 vsg::ref_ptr<vsg::BindGraphicsPipeline> PipelineCache::getOrCreateBindGraphicsPipeline(uint32_t shaderModeMask, uint32_t geometryAttributesMask, const vsg::Path& vertShaderPath, const vsg::Path& fragShaderPath, vsg::ref_ptr<const vsg::Options> options)
 {
     Key key(shaderModeMask, geometryAttributesMask, vertShaderPath, fragShaderPath);
 
-    // check to see if pipeline has already been created
+    std::promise<vsg::ref_ptr<vsg::BindGraphicsPipeline>> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // check to see if pipeline has already been created
+        if (auto itr = pipelineMap.find(key); itr != pipelineMap.end())
+        {
+            ++statistics.hits;
+            itr->second.lastUsed = ++useCount;
+            return itr->second.bindGraphicsPipeline;
+        }
+
+        // check to see if another thread is already creating it
+        if (auto itr = pendingMap.find(key); itr != pendingMap.end())
+        {
+            ++statistics.hits;
+            auto future = itr->second;
+            lock.unlock();
+            return future.get();
+        }
+
+        ++statistics.misses;
+        pendingMap[key] = promise.get_future().share();
+    }
+
+    vsg::ref_ptr<vsg::BindGraphicsPipeline> bindGraphicsPipeline;
+    try
+    {
+        bindGraphicsPipeline = createBindGraphicsPipeline(shaderModeMask, geometryAttributesMask, vertShaderPath, fragShaderPath, options);
+    }
+    catch (...)
+    {
+        // pass the failure on to the threads waiting on this pipeline and leave no pending entry behind, so later requests try again
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            pendingMap.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    // assign the pipeline to cache and release any threads waiting on it.
     {
         std::lock_guard<std::mutex> guard(mutex);
-        if (auto itr = pipelineMap.find(key); itr != pipelineMap.end()) return itr->second;
+        if (bindGraphicsPipeline)
+        {
+            evict(1);
+            pipelineMap[key] = Entry{bindGraphicsPipeline, ++useCount};
+            createdKeys.insert(key);
+        }
+        pendingMap.erase(key);
     }
 
+    promise.set_value(bindGraphicsPipeline);
+
+    return bindGraphicsPipeline;
+}
+
+vsg::ref_ptr<vsg::BindGraphicsPipeline> PipelineCache::createBindGraphicsPipeline(uint32_t shaderModeMask, uint32_t geometryAttributesMask, const vsg::Path& vertShaderPath, const vsg::Path& fragShaderPath, vsg::ref_ptr<const vsg::Options> options)
+{
     auto scs = vsg::ShaderCompileSettings::create();
     scs->defines = createPSCDefineStrings(shaderModeMask, geometryAttributesMask);
 
@@ -87,6 +307,10 @@ vsg::ref_ptr<vsg::BindGraphicsPipeline> PipelineCache::getOrCreateBindGraphicsPi
     if (!fragmentShader) fragmentShader = fbxshader_frag(); // fallback to shaders/fbxshader_frag.cpp
     fragmentShader->module->hints = scs;
 
+    // use the SPIR-V compiled at build time, then the options->fileCache, only compiling at runtime when neither has the permutation
+    if (!assignPrecompiledSPIRV(*vertexShader)) readOrCompileSPIRV(*vertexShader, options);
+    if (!assignPrecompiledSPIRV(*fragmentShader)) readOrCompileSPIRV(*fragmentShader, options);
+
     vsg::ShaderStages shaders{vertexShader, fragmentShader};
 
     // std::cout<<"createBindGraphicsPipeline("<<shaderModeMask<<", "<<geometryAttributesMask<<")"<<std::endl;
@@ -123,38 +347,67 @@ vsg::ref_ptr<vsg::BindGraphicsPipeline> PipelineCache::getOrCreateBindGraphicsPi
         vertexBindingIndex++;
     }
 
-    if (geometryAttributesMask & NORMAL)
-    {
-        VkVertexInputRate normal_rate = geometryAttributesMask & NORMAL_OVERALL ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
-        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::vec3), normal_rate});
-        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{NORMAL_CHANNEL, vertexBindingIndex, VK_FORMAT_R32G32B32_SFLOAT, 0}); // normal as vec3
-        vertexBindingIndex++;
-    }
-    if (geometryAttributesMask & TANGENT)
+    // the remaining attributes in the same order as the arrays assigned by convertToVsg(osg::Geometry*, ..)
+    struct VertexAttribute
     {
-        VkVertexInputRate tangent_rate = geometryAttributesMask & TANGENT_OVERALL ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
-        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::vec4), tangent_rate});
-        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{TANGENT_CHANNEL, vertexBindingIndex, VK_FORMAT_R32G32B32A32_SFLOAT, 0}); // tangent as vec4
-        vertexBindingIndex++;
-    }
-    if (geometryAttributesMask & COLOR)
+        uint32_t mask;
+        uint32_t overallMask;
+        uint32_t location;
+        VkFormat format;
+        uint32_t size;
+        VkFormat quantizedFormat;
+        uint32_t quantizedSize;
+    };
+
+    const VertexAttribute vertexAttributes[] = {
+        {NORMAL, NORMAL_OVERALL, NORMAL_CHANNEL, VK_FORMAT_R32G32B32_SFLOAT, sizeof(vsg::vec3), VK_FORMAT_R16G16_SNORM, sizeof(vsg::svec2)},                  // normal as vec3 or octahedral svec2
+        {TANGENT, TANGENT_OVERALL, TANGENT_CHANNEL, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(vsg::vec4), VK_FORMAT_R16G16B16A16_SNORM, sizeof(vsg::svec4)},     // tangent as vec4 or octahedral svec4
+        {COLOR, COLOR_OVERALL, COLOR_CHANNEL, VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(vsg::vec4), VK_FORMAT_R8G8B8A8_UNORM, sizeof(vsg::ubvec4)},              // color as vec4 or ubvec4
+        {TEXCOORD0, 0, TEXCOORD0_CHANNEL, VK_FORMAT_R32G32_SFLOAT, sizeof(vsg::vec2), VK_FORMAT_R16G16_SFLOAT, sizeof(vsg::usvec2)},                         // texcoord as vec2 or half float usvec2
+        {TRANSLATE, TRANSLATE_OVERALL, TRANSLATE_CHANNEL, VK_FORMAT_R32G32B32_SFLOAT, sizeof(vsg::vec3), VK_FORMAT_R32G32B32_SFLOAT, sizeof(vsg::vec3)}}; // translation as vec3
+
+    bool quantized = (geometryAttributesMask & QUANTIZED) != 0;
+
+    // with INTERLEAVED the per vertex attributes share a single binding after the vertices, leaving just the per instance attributes in their own bindings
+    if (geometryAttributesMask & INTERLEAVED)
     {
-        VkVertexInputRate color_rate = geometryAttributesMask & COLOR_OVERALL ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
-        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::vec4), color_rate});
-        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{COLOR_CHANNEL, vertexBindingIndex, VK_FORMAT_R32G32B32A32_SFLOAT, 0}); // color as vec4
-        vertexBindingIndex++;
+        uint32_t offset = 0;
+        for (auto& attribute : vertexAttributes)
+        {
+            if ((geometryAttributesMask & attribute.mask) && !(geometryAttributesMask & attribute.overallMask))
+            {
+                vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{attribute.location, vertexBindingIndex, quantized ? attribute.quantizedFormat : attribute.format, offset});
+                offset += quantized ? attribute.quantizedSize : attribute.size;
+            }
+        }
+
+        if (offset > 0)
+        {
+            vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, offset, VK_VERTEX_INPUT_RATE_VERTEX});
+            vertexBindingIndex++;
+        }
     }
-    if (geometryAttributesMask & TEXCOORD0)
+
+    for (auto& attribute : vertexAttributes)
     {
-        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::vec2), VK_VERTEX_INPUT_RATE_VERTEX});
-        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{TEXCOORD0_CHANNEL, vertexBindingIndex, VK_FORMAT_R32G32_SFLOAT, 0}); // texcoord as vec2
+        if (!(geometryAttributesMask & attribute.mask)) continue;
+
+        bool overall = (geometryAttributesMask & attribute.overallMask) != 0;
+        if ((geometryAttributesMask & INTERLEAVED) && !overall) continue;
+
+        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, quantized ? attribute.quantizedSize : attribute.size, overall ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX});
+        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{attribute.location, vertexBindingIndex, quantized ? attribute.quantizedFormat : attribute.format, 0});
         vertexBindingIndex++;
     }
-    if (geometryAttributesMask & TRANSLATE)
+
+    // the per instance mat4 is bound as four vec4 columns at consecutive locations
+    if (geometryAttributesMask & INSTANCE_MATRIX)
     {
-        VkVertexInputRate trate = geometryAttributesMask & TRANSLATE_OVERALL ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
-        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::vec3), trate});
-        vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{TRANSLATE_CHANNEL, vertexBindingIndex, VK_FORMAT_R32G32B32_SFLOAT, 0}); // translation as vec3
+        vertexBindingsDescriptions.push_back(VkVertexInputBindingDescription{vertexBindingIndex, sizeof(vsg::mat4), VK_VERTEX_INPUT_RATE_INSTANCE});
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            vertexAttributeDescriptions.push_back(VkVertexInputAttributeDescription{INSTANCE_MATRIX_CHANNEL + column, vertexBindingIndex, VK_FORMAT_R32G32B32A32_SFLOAT, column * static_cast<uint32_t>(sizeof(vsg::vec4))});
+        }
         vertexBindingIndex++;
     }
 
@@ -194,11 +447,5 @@ vsg::ref_ptr<vsg::BindGraphicsPipeline> PipelineCache::getOrCreateBindGraphicsPi
     // set up graphics pipeline
     //
     vsg::ref_ptr<vsg::GraphicsPipeline> graphicsPipeline = vsg::GraphicsPipeline::create(pipelineLayout, shaders, pipelineStates);
-    auto bindGraphicsPipeline = vsg::BindGraphicsPipeline::create(graphicsPipeline);
-
-    // assign the pipeline to cache.
-    std::lock_guard<std::mutex> guard(mutex);
-    pipelineMap[key] = bindGraphicsPipeline;
-
-    return bindGraphicsPipeline;
+    return vsg::BindGraphicsPipeline::create(graphicsPipeline);
 }
@@ -2,20 +2,79 @@
 
 #include <vsg/all.h>
 
+#include <future>
+
 #include "GeometryUtils.h"
 #include "ShaderUtils.h"
+#include "TaskPool.h"
 
 namespace osg2vsg
 {
+    struct PipelineManifest;
+
     struct PipelineCache : public vsg::Inherit<vsg::Object, PipelineCache>
     {
         using Key = std::tuple<uint32_t, uint32_t, vsg::Path, vsg::Path>;
-        using PipelineMap = std::map<Key, vsg::ref_ptr<vsg::BindGraphicsPipeline>>;
+
+        struct Entry
+        {
+            vsg::ref_ptr<vsg::BindGraphicsPipeline> bindGraphicsPipeline;
+            uint64_t lastUsed = 0; // value of useCount when the entry was last returned, used to find the least recently used entries
+        };
+
+        using PipelineMap = std::map<Key, Entry>;
+        using PendingMap = std::map<Key, std::shared_future<vsg::ref_ptr<vsg::BindGraphicsPipeline>>>;
+
+        struct Statistics
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            size_t size = 0;
+        };
 
         std::mutex mutex;
         PipelineMap pipelineMap;
+        PendingMap pendingMap; // pipelines currently being created, later requesters for the same Key wait on these rather than creating their own
+        std::set<Key> createdKeys; // every Key created, including evicted ones, used to create the manifest
+
+        size_t capacity = 0; // maximum number of pipelines to retain, 0 for unlimited. Only pipelines no longer referenced by any scene graph are evicted so the cache can exceed this.
+        uint64_t useCount = 0;
+        Statistics statistics;
+        std::once_flag prebuildOnce; // ensures a manifest is only prebuilt once per cache
+        size_t numManifestKeys = 0;  // number of keys in the last manifest written by writeManifest()
 
         vsg::ref_ptr<vsg::BindGraphicsPipeline> getOrCreateBindGraphicsPipeline(uint32_t shaderModeMask, uint32_t geometryMask, const vsg::Path& vertShaderPath, const vsg::Path& fragShaderPath, vsg::ref_ptr<const vsg::Options> options);
+
+        vsg::ref_ptr<vsg::BindGraphicsPipeline> createBindGraphicsPipeline(uint32_t shaderModeMask, uint32_t geometryMask, const vsg::Path& vertShaderPath, const vsg::Path& fragShaderPath, vsg::ref_ptr<const vsg::Options> options);
+
+        /// set the capacity, evicting least recently used unreferenced pipelines to bring the cache within it.
+        void setCapacity(size_t newCapacity);
+
+        /// get a snapshot of the hit, miss and eviction counters along with the current number of cached pipelines.
+        Statistics getStatistics();
+
+        /// create a manifest listing the Key of every pipeline created so far.
+        vsg::ref_ptr<PipelineManifest> createManifest();
+
+        /// create all the pipelines listed in the manifest, in parallel when a taskPool is provided, so they are ready before the first conversion.
+        void prebuild(const PipelineManifest& manifest, vsg::ref_ptr<const vsg::Options> options, vsg::ref_ptr<TaskPool> taskPool = {});
+
+        /// write the manifest to filename if pipelines have been added since the last write, return true if the file was written.
+        bool writeManifest(const vsg::Path& filename, vsg::ref_ptr<const vsg::Options> options);
+
+    protected:
+        /// evict least recently used pipelines only referenced by the cache until there is room for numToAdd more within capacity, mutex must be locked by caller.
+        void evict(size_t numToAdd);
+    };
+
+    /// list of PipelineCache keys that can be written to file after conversion and read back to prebuild the pipelines at startup.
+    struct PipelineManifest : public vsg::Inherit<vsg::Object, PipelineManifest>
+    {
+        std::vector<PipelineCache::Key> keys;
+
+        virtual void read(vsg::Input& input);
+        virtual void write(vsg::Output& output) const;
     };
 
     struct BuildOptions : public vsg::Inherit<vsg::Object, BuildOptions>
@@ -46,8 +105,43 @@ namespace osg2vsg
 
         vsg::Path extension = "vsgb";
 
+        bool parallelConversion = false; // convert sibling subgraphs concurrently using taskPool
+        uint32_t numThreads = 0;         // number of worker threads to create when no taskPool is assigned, 0 selects the hardware concurrency
+        bool zeroCopyArrays = false;     // vsg arrays share the storage of the osg arrays where the layouts match rather than copying them, keeping the osg arrays alive. optimizeVertexCache still copies the arrays it reorders
+        bool splitLargeGeometries = false; // split meshes with more than 65536 vertices into VertexIndexDraw chunks so each can use 16 bit indices
+        bool uint8Indices = false;         // use ubyte indices for draws with at most 256 vertices, requires the VK_EXT_index_type_uint8 extension to be enabled
+        bool interleavedArrays = false;    // pack the per vertex attributes other than the vertices into one interleaved array and vertex binding
+        bool quantizeArrays = false;       // store normals and tangents octahedral encoded, colors as unorm8 and texcoords as half floats
+        bool shareIdenticalData = false;   // share byte identical arrays and geometries converted from separate osg objects
+        bool batchSmallGeometries = false; // merge sibling geometries with the same pipeline and descriptor state into combined draws
+        uint32_t maxBatchVertices = 65535; // largest number of vertices in a merged geometry, the default keeps batches within 16 bit indices
+        bool instanceRepeatedGeometries = false; // draw a geometry repeated under sibling MatrixTransforms as one instanced draw with a per instance matrix
+        uint32_t minInstanceCount = 2;     // fewest repeats of a geometry to replace with an instanced draw
+        bool chunkLargeGeometries = false; // partition geometries exceeding maxChunkTriangles or maxChunkExtent into a CullGroup hierarchy of spatial chunks
+        uint32_t maxChunkTriangles = 16384; // most triangles in a spatial chunk
+        double maxChunkExtent = 0.0;        // largest extent of a spatial chunk along any axis, 0 for no limit
+        bool optimizeVertexCache = false;   // reorder triangles for the post transform vertex cache and vertices for sequential fetches
+        bool optimizeOverdraw = false;      // draw the triangle clusters of opaque geometries most likely to occlude the rest first
+        bool analyzeOverdraw = false;       // rasterize each overdraw optimized geometry before and after reordering to record the reduction in statistics, costly so off by default
+        float overdrawThreshold = 1.05f;    // vertex cache miss rate allowed relative to vertex cache order, higher values give finer clusters that reduce overdraw further but take longer
+        bool generateLODs = false;          // wrap geometries of more than lodTriangleThreshold triangles in a vsg::LOD of quadric error simplified levels
+        uint32_t lodTriangleThreshold = 65536; // fewest triangles for a geometry to be given generated levels of detail
+        uint32_t numLODLevels = 3;          // most simplified levels to generate below the full detail level
+        float lodReduction = 0.25f;         // fraction of the triangles of the previous level each simplified level targets
+        double lodScreenRatio = 0.25;       // minimum screen height ratio of the full detail level, lower levels switch at successively smaller ratios
+        bool tightBounds = true;            // fit cull, depth sort and LOD bounding spheres to the converted vertices rather than enclosing their bounding boxes
+        bool batchBillboards = false;       // gather billboards sharing a drawable and state from across the scene into spatially clustered instanced draws
+        uint32_t maxBillboardsPerBatch = 1024; // most billboard positions in one instanced draw
+        double maxBillboardBatchExtent = 0.0;  // largest extent of the positions in one instanced draw along any axis, 0 for no limit
+        bool collectStatistics = false;     // create statistics, when none is assigned, and report them with vsg::debug after conversion
+
         vsg::ref_ptr<PipelineCache> pipelineCache;
+        vsg::ref_ptr<TaskPool> taskPool;
+        vsg::ref_ptr<ConversionStatistics> statistics;
+        vsg::ref_ptr<DataCache> dataCache; // used when shareIdenticalData is set
+        vsg::ref_ptr<TangentCache> tangentCache; // reuses tangents generated for geometries with identical content
     };
 } // namespace osg2vsg
 
 EVSG_type_name(osg2vsg::BuildOptions);
+EVSG_type_name(osg2vsg::PipelineManifest);
@@ -21,9 +21,199 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <osg2vsg/convert.h>
 
 #include "ConvertToVsg.h"
+#include "BoundingSphere.h"
+
+#include <functional>
+#include <limits>
 
 using namespace osg2vsg;
 
+namespace
+{
+    // bounds of all the instances of a geometry, computed up front from the transformed corners of the geometry's vertex bounds
+    struct InstancesBoundingBox : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+        osg::BoundingBox bb;
+
+        InstancesBoundingBox(const osg::Array* vertices, const osg::MatrixfArray& matrices)
+        {
+            osg::BoundingBox local_bb;
+            if (auto vec3s = dynamic_cast<const osg::Vec3Array*>(vertices))
+            {
+                for (auto& vertex : *vec3s) local_bb.expandBy(vertex);
+            }
+            else if (auto dvec3s = dynamic_cast<const osg::Vec3dArray*>(vertices))
+            {
+                for (auto& vertex : *dvec3s) local_bb.expandBy(vertex);
+            }
+
+            if (!local_bb.valid()) return;
+
+            for (auto& matrix : matrices)
+            {
+                for (int i = 0; i < 8; ++i) bb.expandBy(local_bb.corner(i) * matrix);
+            }
+        }
+
+        osg::BoundingBox computeBound(const osg::Drawable&) const override
+        {
+            return bb;
+        }
+    };
+
+    // the geometry drawn by a static MatrixTransform with a single child, either the geometry itself or a Geode containing just the geometry.
+    // instancing bypasses the traversal so the transform, Geode and geometry must all pass the visitor's node mask checks and share one node mask.
+    osg::Geometry* instanceableGeometry(osg::Node* node, const osg::NodeVisitor& nv)
+    {
+        auto transform = dynamic_cast<osg::MatrixTransform*>(node);
+        if (!transform || !nv.validNodeMask(*transform) || transform->getNumChildren() != 1 || transform->getNumParents() > 1 || transform->getStateSet()) return nullptr;
+        if (transform->getDataVariance() == osg::Object::DYNAMIC || transform->getReferenceFrame() != osg::Transform::RELATIVE_RF) return nullptr;
+        if (transform->getUpdateCallback() || transform->getCullCallback()) return nullptr;
+
+        auto child = transform->getChild(0);
+        if (auto geode = child->asGeode())
+        {
+            if (geode->getNodeMask() != transform->getNodeMask() || geode->getNumChildren() != 1 || geode->getNumParents() > 1 || geode->getStateSet()) return nullptr;
+            child = geode->getChild(0);
+        }
+
+        auto geometry = child->asGeometry();
+        if (!geometry || geometry->getNodeMask() != transform->getNodeMask() || !geometry->getVertexArray() || geometry->getVertexAttribArray(7) || geometry->getVertexAttribArray(8)) return nullptr;
+
+        // instancing is expressed with BIND_OVERALL arrays so the geometry can't already use them
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+        for (auto& array : arrays)
+        {
+            if (array->getBinding() == osg::Array::BIND_OVERALL) return nullptr;
+        }
+        return geometry;
+    }
+
+    // the children of group to be replaced by an instanced draw of the geometry they all draw, keyed by that geometry and their common node mask
+    using Instances = std::map<std::pair<osg::Geometry*, osg::Node::NodeMask>, std::vector<unsigned int>>;
+    Instances collectInstances(osg::Group& group, const BuildOptions& buildOptions, const osg::NodeVisitor& nv)
+    {
+        Instances instances;
+        if (!buildOptions.instanceRepeatedGeometries || !(buildOptions.supportedGeometryAttributes & INSTANCE_MATRIX)) return instances;
+
+        for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+        {
+            auto child = group.getChild(i);
+            if (auto geometry = instanceableGeometry(child, nv)) instances[{geometry, child->getNodeMask()}].push_back(i);
+        }
+
+        for (auto itr = instances.begin(); itr != instances.end();)
+        {
+            if (itr->second.size() < std::max(buildOptions.minInstanceCount, 2u))
+                itr = instances.erase(itr);
+            else
+                ++itr;
+        }
+        return instances;
+    }
+
+    // mirrors the order and state in which ConvertToVsg visits the scene graph, recording the state that each node with multiple parents is first reached with.
+    struct CollectSharedNodeContexts : public osg::NodeVisitor
+    {
+        CollectSharedNodeContexts(const BuildOptions& in_buildOptions) :
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+            buildOptions(in_buildOptions) {}
+
+        using osg::NodeVisitor::apply;
+
+        const BuildOptions& buildOptions;
+        std::set<osg::Node*> visited;
+        ConvertToVsg::StateStack statestack;
+        uint32_t nodeShaderModeMasks = ShaderModeMask::NONE;
+        ConvertToVsg::NodeContextMap contexts;
+
+        void convert(osg::Node* node)
+        {
+            if (!node || !visited.insert(node).second) return;
+
+            if (node->getNumParents() > 1) contexts[node] = ConvertToVsg::NodeContext(statestack, nodeShaderModeMasks);
+
+            node->accept(*this);
+        }
+
+        void push(osg::StateSet* stateset)
+        {
+            if (stateset) statestack.push_back(stateset);
+        }
+
+        void pop(osg::StateSet* stateset)
+        {
+            if (stateset) statestack.pop_back();
+        }
+
+        void apply(osg::Group& group) override
+        {
+            if (dynamic_cast<osgTerrain::TerrainTile*>(&group))
+            {
+                group.traverse(*this);
+                return;
+            }
+
+            // instanced transforms are replaced by a new geometry so, as in ConvertToVsg::createInstancedGroup(), aren't reached through their shared geometry.
+            // createBatchedGroup() only merges geometries with a single parent so can't change the state a shared node is first reached with.
+            std::set<unsigned int> instancedChildren;
+            for (auto& [geometry, children] : collectInstances(group, buildOptions, *this)) instancedChildren.insert(children.begin(), children.end());
+
+            push(group.getStateSet());
+            for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+            {
+                if (instancedChildren.count(i) == 0) convert(group.getChild(i));
+            }
+            pop(group.getStateSet());
+        }
+
+        void apply(osg::Billboard& billboard) override
+        {
+            push(billboard.getStateSet());
+
+            nodeShaderModeMasks = buildOptions.billboardTransform ? BILLBOARD : (BILLBOARD | SHADER_TRANSLATE);
+
+            // with SHADER_TRANSLATE the drawables are converted directly rather than via convert()
+            if ((nodeShaderModeMasks & SHADER_TRANSLATE) == 0)
+            {
+                for (unsigned int i = 0; i < billboard.getNumDrawables(); ++i) convert(billboard.getDrawable(i));
+            }
+
+            nodeShaderModeMasks = NONE;
+
+            pop(billboard.getStateSet());
+        }
+
+        void apply(osg::LOD& lod) override
+        {
+            unsigned int numChildren = std::min(lod.getNumChildren(), lod.getNumRanges());
+            for (unsigned int i = 0; i < numChildren; ++i) convert(lod.getChild(i));
+        }
+
+        void apply(osg::PagedLOD& plod) override
+        {
+            unsigned int numChildren = std::min(plod.getNumChildren(), plod.getNumRanges());
+            for (unsigned int i = 0; i < numChildren; ++i) convert(plod.getChild(i));
+        }
+
+        void apply(osg::Switch& sw) override
+        {
+            for (unsigned int i = 0; i < sw.getNumChildren(); ++i) convert(sw.getChild(i));
+        }
+    };
+} // namespace
+
+ConvertToVsg::ConvertToVsg(ConvertToVsg& parent, const NodeContext& context) :
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+    SceneBuilderBase(parent.buildOptions),
+    inheritedStateGroup(parent.inheritedStateGroup)
+{
+    cacheOwner = &parent.shared();
+    statestack = context.first;
+    nodeShaderModeMasks = context.second;
+}
+
 vsg::ref_ptr<vsg::BindGraphicsPipeline> ConvertToVsg::getOrCreateBindGraphicsPipeline(uint32_t shaderModeMask, uint32_t geometryMask)
 {
     return buildOptions->pipelineCache->getOrCreateBindGraphicsPipeline(shaderModeMask, geometryMask, buildOptions->vertexShaderPath, buildOptions->fragmentShaderPath, buildOptions->options);
@@ -31,11 +221,16 @@ vsg::ref_ptr<vsg::BindGraphicsPipeline> ConvertToVsg::getOrCreateBindGraphicsPip
 
 vsg::ref_ptr<vsg::BindDescriptorSet> ConvertToVsg::getOrCreateBindDescriptorSet(uint32_t shaderModeMask, uint32_t geometryMask, osg::StateSet* stateset)
 {
+    auto& caches = shared();
+
     MasksAndState masksAndState(shaderModeMask, geometryMask, stateset);
-    if (auto itr = bindDescriptorSetMap.find(masksAndState); itr != bindDescriptorSetMap.end())
     {
-        // std::cout<<"reusing bindDescriptorSet "<<itr->second.get()<<std::endl;
-        return itr->second;
+        std::lock_guard<std::mutex> guard(caches.cacheMutex);
+        if (auto itr = caches.bindDescriptorSetMap.find(masksAndState); itr != caches.bindDescriptorSetMap.end())
+        {
+            // std::cout<<"reusing bindDescriptorSet "<<itr->second.get()<<std::endl;
+            return itr->second;
+        }
     }
 
     auto bindGraphicsPipeline = getOrCreateBindGraphicsPipeline(shaderModeMask, geometryMask);
@@ -54,27 +249,31 @@ vsg::ref_ptr<vsg::BindDescriptorSet> ConvertToVsg::getOrCreateBindDescriptorSet(
 
     auto bindDescriptorSet = vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, descriptorSet);
 
-    bindDescriptorSetMap[masksAndState] = bindDescriptorSet;
-
-    return bindDescriptorSet;
+    // keep the first one created so that when converting in parallel all geometries with the same masks and state share it
+    std::lock_guard<std::mutex> guard(caches.cacheMutex);
+    return caches.bindDescriptorSetMap.emplace(masksAndState, bindDescriptorSet).first->second;
 }
 
 vsg::Path ConvertToVsg::mapFileName(const std::string& filename)
 {
-    if (auto itr = filenameMap.find(filename); itr != filenameMap.end())
+    auto& caches = shared();
+    std::lock_guard<std::mutex> guard(caches.cacheMutex);
+
+    if (auto itr = caches.filenameMap.find(filename); itr != caches.filenameMap.end())
     {
         return itr->second;
     }
 
     vsg::Path vsg_filename = vsg::removeExtension(filename) + "." + buildOptions->extension;
 
-    filenameMap[filename] = vsg_filename;
+    caches.filenameMap[filename] = vsg_filename;
 
     return vsg_filename;
 }
 
 void ConvertToVsg::optimize(osg::Node* osg_scene)
 {
+    // vertex cache and fetch ordering is done on the converted vsg arrays instead, see BuildOptions::optimizeVertexCache
 #if 0
     osgUtil::IndexMeshVisitor imv;
 #    if OSG_MIN_VERSION_REQUIRED(3, 6, 4)
@@ -98,31 +297,151 @@ void ConvertToVsg::optimize(osg::Node* osg_scene)
     osg2vsg::OptimizeOsgBillboards optimizeBillboards;
     osg_scene->accept(optimizeBillboards);
     optimizeBillboards.optimize();
+
+    if (buildOptions->batchBillboards)
+    {
+        osg2vsg::BatchOsgBillboards batchBillboards(buildOptions->maxBillboardsPerBatch, buildOptions->maxBillboardBatchExtent);
+        osg_scene->accept(batchBillboards);
+        batchBillboards.batch(buildOptions->statistics.get());
+    }
+}
+
+void ConvertToVsg::setUpParallelConversion(osg::Node* osg_scene)
+{
+    if (!buildOptions->parallelConversion || !osg_scene) return;
+
+    taskPool = buildOptions->taskPool;
+    if (!taskPool) taskPool = TaskPool::create(buildOptions->numThreads);
+
+    // compute the bounds up front as osg computes them lazily, which isn't safe to do from multiple threads.
+    osg_scene->getBound();
+
+    CollectSharedNodeContexts collectSharedNodeContexts(*buildOptions);
+    collectSharedNodeContexts.convert(osg_scene);
+    sharedNodeContexts.swap(collectSharedNodeContexts.contexts);
+
+    Textures textures;
+    collectTextures(osg_scene, textures);
+    convertTextures(textures, *taskPool);
 }
 
 vsg::ref_ptr<vsg::Node> ConvertToVsg::convert(osg::Node* node)
 {
     root = nullptr;
 
-    if (auto itr = nodeMap.find(node); itr != nodeMap.end())
+    auto& caches = shared();
+    if (!caches.taskPool)
     {
-        root = itr->second;
+        if (auto itr = nodeMap.find(node); itr != nodeMap.end())
+        {
+            root = itr->second;
+        }
+        else
+        {
+            if (node) node->accept(*this);
+
+            nodeMap[node] = root;
+
+            if (root && buildOptions->copyNames && !node->getName().empty())
+            {
+                root->setValue("Name", node->getName());
+            }
+        }
+
+        return root;
     }
-    else
+
+    // parallel conversion, the first thread to reach a node converts it, others wait for its result.
+    std::promise<vsg::ref_ptr<vsg::Node>> promise;
+    {
+        std::unique_lock<std::mutex> lock(caches.cacheMutex);
+        if (auto itr = caches.nodeMap.find(node); itr != caches.nodeMap.end())
+        {
+            root = itr->second;
+            return root;
+        }
+
+        if (auto itr = caches.pendingNodes.find(node); itr != caches.pendingNodes.end())
+        {
+            auto future = itr->second;
+            lock.unlock();
+
+            root = future.get();
+            return root;
+        }
+
+        caches.pendingNodes[node] = promise.get_future().share();
+    }
+
+    if (node)
     {
-        if (node) node->accept(*this);
+        // shared nodes are converted with the state they are first reached with in the serial traversal, regardless of which thread gets to them first.
+        if (auto itr = caches.sharedNodeContexts.find(node); itr != caches.sharedNodeContexts.end())
+        {
+            NodeContext previous(statestack, nodeShaderModeMasks);
+            statestack = itr->second.first;
+            nodeShaderModeMasks = itr->second.second;
 
-        nodeMap[node] = root;
+            node->accept(*this);
 
-        if (root && buildOptions->copyNames && !node->getName().empty())
+            statestack.swap(previous.first);
+            nodeShaderModeMasks = previous.second;
+        }
+        else
         {
-            root->setValue("Name", node->getName());
+            node->accept(*this);
         }
     }
 
+    if (root && buildOptions->copyNames && !node->getName().empty())
+    {
+        root->setValue("Name", node->getName());
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(caches.cacheMutex);
+        caches.nodeMap[node] = root;
+        caches.pendingNodes.erase(node);
+    }
+
+    promise.set_value(root);
+
     return root;
 }
 
+std::vector<vsg::ref_ptr<vsg::Node>> ConvertToVsg::convertChildren(osg::Group& group, unsigned int numChildren)
+{
+    std::vector<vsg::ref_ptr<vsg::Node>> children(numChildren);
+
+    auto& pool = shared().taskPool;
+    if (!pool || numChildren < 2)
+    {
+        for (unsigned int i = 0; i < numChildren; ++i)
+        {
+            children[i] = convert(group.getChild(i));
+        }
+        return children;
+    }
+
+    // convert the first child on this thread and the rest as tasks, each with its own converter starting from the current state.
+    NodeContext context(statestack, nodeShaderModeMasks);
+
+    TaskPool::TaskGroup tasks;
+    for (unsigned int i = 1; i < numChildren; ++i)
+    {
+        pool->run(tasks, [this, &group, &children, &context, i]() {
+            ConvertToVsg converter(*this, context);
+            children[i] = converter.convert(group.getChild(i));
+        });
+    }
+
+    children[0] = convert(group.getChild(0));
+
+    pool->wait(tasks);
+
+    return children;
+}
+
 vsg::ref_ptr<vsg::Data> ConvertToVsg::copy(osg::Array* src_array)
 {
     if (!src_array) return {};
@@ -161,16 +480,16 @@ vsg::ref_ptr<vsg::Data> ConvertToVsg::copy(osg::Array* src_array)
     case (osg::Array::Vec4usArrayType): return copyArray<vsg::usvec4Array>(src_array);
 
     case (osg::Array::Vec2uiArrayType): return copyArray<vsg::uivec2Array>(src_array);
-    case (osg::Array::Vec3uiArrayType): return copyArray<vsg::usvec3Array>(src_array);
-    case (osg::Array::Vec4uiArrayType): return copyArray<vsg::usvec4Array>(src_array);
+    case (osg::Array::Vec3uiArrayType): return copyArray<vsg::uivec3Array>(src_array);
+    case (osg::Array::Vec4uiArrayType): return copyArray<vsg::uivec4Array>(src_array);
 
     case (osg::Array::Vec2ArrayType): return copyArray<vsg::vec2Array>(src_array);
     case (osg::Array::Vec3ArrayType): return copyArray<vsg::vec3Array>(src_array);
     case (osg::Array::Vec4ArrayType): return copyArray<vsg::vec4Array>(src_array);
 
     case (osg::Array::Vec2dArrayType): return copyArray<vsg::dvec2Array>(src_array);
-    case (osg::Array::Vec3dArrayType): return copyArray<vsg::dvec2Array>(src_array);
-    case (osg::Array::Vec4dArrayType): return copyArray<vsg::dvec2Array>(src_array);
+    case (osg::Array::Vec3dArrayType): return copyArray<vsg::dvec3Array>(src_array);
+    case (osg::Array::Vec4dArrayType): return copyArray<vsg::dvec4Array>(src_array);
 
     case (osg::Array::MatrixArrayType): return copyArray<vsg::mat4Array>(src_array);
     case (osg::Array::MatrixdArrayType): return copyArray<vsg::dmat4Array>(src_array);
@@ -185,6 +504,242 @@ vsg::ref_ptr<vsg::Data> ConvertToVsg::copy(osg::Array* src_array)
     }
 }
 
+vsg::ref_ptr<vsg::Node> ConvertToVsg::createSpatialChunks(osg::Geometry& geometry, uint32_t geometryMask, bool opaque)
+{
+    if (!buildOptions->chunkLargeGeometries) return {};
+
+    auto chunks = partitionGeometry(geometry, buildOptions->maxChunkTriangles, buildOptions->maxChunkExtent);
+    if (chunks.nodes.empty()) return {};
+
+    size_t numChunks = 0;
+    std::function<vsg::ref_ptr<vsg::Node>(const SpatialChunks::Node&)> createNode = [&](const SpatialChunks::Node& chunk) -> vsg::ref_ptr<vsg::Node> {
+        vsg::dvec3 bb_min(chunk.bound.xMin(), chunk.bound.yMin(), chunk.bound.zMin());
+        vsg::dvec3 bb_max(chunk.bound.xMax(), chunk.bound.yMax(), chunk.bound.zMax());
+        vsg::dsphere boundingSphere((bb_min + bb_max) * 0.5, vsg::length(bb_max - bb_min) * 0.5);
+
+        if (chunk.geometry)
+        {
+            auto command = osg2vsg::convertToVsg(chunk.geometry.get(), geometryMask, *buildOptions, opaque);
+            if (!command) return {};
+
+            ++numChunks;
+            if (buildOptions->tightBounds) boundingSphere = computeTightBound(*command, boundingSphere, buildOptions->statistics.get());
+            return vsg::CullNode::create(boundingSphere, createLODs(command, *buildOptions));
+        }
+
+        auto cullGroup = vsg::CullGroup::create(boundingSphere);
+        std::vector<vsg::dsphere> childBounds;
+        for (auto child : chunk.children)
+        {
+            if (auto node = createNode(chunks.nodes[child]))
+            {
+                cullGroup->addChild(node);
+                if (auto cullNode = node.cast<vsg::CullNode>())
+                    childBounds.push_back(cullNode->bound);
+                else if (auto childGroup = node.cast<vsg::CullGroup>())
+                    childBounds.push_back(childGroup->bound);
+            }
+        }
+        if (cullGroup->children.empty()) return {};
+
+        // enclose the children's bounds rather than revisiting all their vertices
+        if (buildOptions->tightBounds) cullGroup->bound = selectTightBound(enclosingSphere(childBounds), boundingSphere, buildOptions->statistics.get());
+        return cullGroup;
+    };
+
+    auto root = createNode(chunks.nodes.front());
+    if (!root) return {};
+
+    if (auto& statistics = buildOptions->statistics)
+    {
+        ++statistics->numChunkedGeometries;
+        statistics->numSpatialChunks += numChunks;
+    }
+
+    return root;
+}
+
+osg::ref_ptr<osg::Group> ConvertToVsg::createInstancedGroup(osg::Group& group)
+{
+    auto instances = collectInstances(group, *buildOptions, *this);
+    if (instances.empty()) return {};
+
+    // the instanced geometry replaces the first of its transforms, keeping the order of the remaining children
+    std::map<unsigned int, osg::ref_ptr<osg::Node>> instancedGeometries;
+    std::set<unsigned int> replacedChildren;
+    size_t numInstances = 0;
+    for (auto& [key, children] : instances)
+    {
+        auto& [geometry, nodeMask] = key;
+
+        // the float instance matrices are made relative to the centre of the instances, which a double precision transform above them restores,
+        // so instances of geo-referenced tiles far from the origin keep their precision
+        osg::BoundingBoxd translations;
+        for (auto i : children) translations.expandBy(static_cast<osg::MatrixTransform*>(group.getChild(i))->getMatrix().getTrans());
+        osg::Vec3d origin = translations.center();
+
+        osg::ref_ptr<osg::MatrixfArray> matrices = new osg::MatrixfArray;
+        for (auto i : children)
+        {
+            matrices->push_back(osg::Matrixf(static_cast<osg::MatrixTransform*>(group.getChild(i))->getMatrix() * osg::Matrixd::translate(-origin)));
+            replacedChildren.insert(i);
+        }
+        matrices->setBinding(osg::Array::BIND_OVERALL);
+
+        // shallow copy so the source geometry and its other uses are left unchanged
+        osg::ref_ptr<osg::Geometry> instanced = new osg::Geometry(*geometry, osg::CopyOp::SHALLOW_COPY);
+        instanced->setVertexAttribArray(8, matrices.get());
+        instanced->setComputeBoundingBoxCallback(new InstancesBoundingBox(geometry->getVertexArray(), *matrices));
+        instanced->dirtyBound();
+        instanced->setNodeMask(nodeMask);
+
+        osg::ref_ptr<osg::Node> instancedNode = instanced;
+        if (origin != osg::Vec3d())
+        {
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrixd::translate(origin));
+            transform->setNodeMask(nodeMask);
+            transform->addChild(instanced);
+            instancedNode = transform;
+        }
+
+        instancedGeometries[children.front()] = instancedNode;
+        numInstances += children.size();
+    }
+
+    if (instancedGeometries.empty()) return {};
+
+    osg::ref_ptr<osg::Group> instancedGroup = new osg::Group;
+    for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+    {
+        if (auto itr = instancedGeometries.find(i); itr != instancedGeometries.end())
+            instancedGroup->addChild(itr->second);
+        else if (replacedChildren.count(i) == 0)
+            instancedGroup->addChild(group.getChild(i));
+    }
+
+    if (auto& statistics = buildOptions->statistics)
+    {
+        statistics->numInstancedGeometries += instancedGeometries.size();
+        statistics->numInstances += numInstances;
+    }
+
+    auto& caches = shared();
+    std::lock_guard<std::mutex> guard(caches.cacheMutex);
+    for (auto& [i, instanced] : instancedGeometries) caches.createdNodes.push_back(instanced);
+
+    return instancedGroup;
+}
+
+osg::ref_ptr<osg::Group> ConvertToVsg::createBatchedGroup(osg::Group& group)
+{
+    if (!buildOptions->batchSmallGeometries) return {};
+
+    // geometries are merged with the siblings that have the same masks, StateSet, array types and normalization, so one pipeline and descriptor set serve the batch
+    // and the merged arrays are read as each of them were, and the same node mask so the merged geometry is only drawn where each of them would be
+    using ArrayLayout = std::pair<osg::Array::Type, bool>;
+    using BatchKey = std::tuple<uint32_t, uint32_t, osg::StateSet*, std::vector<ArrayLayout>, osg::Node::NodeMask>;
+    std::map<BatchKey, size_t> openBatches;
+
+    struct Batch
+    {
+        std::vector<osg::Geometry*> geometries;
+        uint32_t numVertices = 0;
+    };
+    std::vector<Batch> batches;
+
+    const size_t notBatched = std::numeric_limits<size_t>::max();
+    std::vector<size_t> batchOfChild(group.getNumChildren(), notBatched);
+
+    for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+    {
+        // merging bypasses the traversal, so geometries it would skip are left to be skipped
+        auto geometry = group.getChild(i)->asGeometry();
+        if (!geometry || !validNodeMask(*geometry) || geometry->getNumParents() > 1 || !geometry->getVertexArray()) continue;
+
+        uint32_t numVertices = geometry->getVertexArray()->getNumElements();
+        if (numVertices == 0 || numVertices > buildOptions->maxBatchVertices) continue;
+
+        // only per vertex vertices, normals, tangents, colors and texcoord0 can be merged
+        uint32_t attributesMask = calculateAttributesMask(geometry);
+        if (attributesMask & (NORMAL_OVERALL | TANGENT_OVERALL | COLOR_OVERALL | TEXCOORD1 | TEXCOORD2 | TRANSLATE | TRANSLATE_OVERALL)) continue;
+
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+
+        size_t numMergeableArrays = 0;
+        for (auto mask : {VERTEX, NORMAL, TANGENT, COLOR, TEXCOORD0})
+        {
+            if (attributesMask & mask) ++numMergeableArrays;
+        }
+
+        std::vector<ArrayLayout> arrayLayouts;
+        bool mergeable = arrays.size() == numMergeableArrays;
+        for (auto& array : arrays)
+        {
+            if (array->getBinding() != osg::Array::BIND_PER_VERTEX || array->getNumElements() != numVertices) mergeable = false;
+            arrayLayouts.emplace_back(array->getType(), array->getNormalize());
+        }
+        if (!mergeable) continue;
+
+        ScopedPushPop spp(*this, geometry->getStateSet());
+
+        uint32_t geometryMask = (attributesMask | buildOptions->overrideGeomAttributes) & buildOptions->supportedGeometryAttributes;
+        uint32_t shaderModeMask = (calculateShaderModeMask() | buildOptions->overrideShaderModeMask | nodeShaderModeMasks) & buildOptions->supportedShaderModeMask;
+
+        // blended geometries are depth sorted individually
+        if (shaderModeMask & BLEND) continue;
+
+        BatchKey key(shaderModeMask, geometryMask, geometry->getStateSet(), arrayLayouts, geometry->getNodeMask());
+        auto itr = openBatches.find(key);
+        if (itr == openBatches.end() || batches[itr->second].numVertices + numVertices > buildOptions->maxBatchVertices)
+        {
+            openBatches[key] = batches.size();
+            batches.emplace_back();
+        }
+
+        size_t batchIndex = openBatches[key];
+        batches[batchIndex].geometries.push_back(geometry);
+        batches[batchIndex].numVertices += numVertices;
+        batchOfChild[i] = batchIndex;
+    }
+
+    // the merged geometry replaces the first child of its batch, keeping the order of the remaining children
+    osg::ref_ptr<osg::Group> batchedGroup = new osg::Group;
+    std::vector<osg::ref_ptr<osg::Geometry>> mergedGeometries;
+    size_t numBatchedGeometries = 0;
+    for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+    {
+        auto child = group.getChild(i);
+        size_t batchIndex = batchOfChild[i];
+        if (batchIndex == notBatched || batches[batchIndex].geometries.size() == 1)
+        {
+            batchedGroup->addChild(child);
+        }
+        else if (batches[batchIndex].geometries.front() == child)
+        {
+            auto merged = mergeGeometries(batches[batchIndex].geometries);
+            merged->setNodeMask(child->getNodeMask());
+            batchedGroup->addChild(merged);
+            mergedGeometries.push_back(merged);
+            numBatchedGeometries += batches[batchIndex].geometries.size();
+        }
+    }
+
+    if (mergedGeometries.empty()) return {};
+
+    if (auto& statistics = buildOptions->statistics)
+    {
+        statistics->numBatches += mergedGeometries.size();
+        statistics->numBatchedGeometries += numBatchedGeometries;
+    }
+
+    auto& caches = shared();
+    std::lock_guard<std::mutex> guard(caches.cacheMutex);
+    caches.createdNodes.insert(caches.createdNodes.end(), mergedGeometries.begin(), mergedGeometries.end());
+
+    return batchedGroup;
+}
+
 uint32_t ConvertToVsg::calculateShaderModeMask()
 {
     if (statestack.empty()) return osg2vsg::ShaderModeMask::NONE;
@@ -199,12 +754,15 @@ void ConvertToVsg::apply(osg::Geometry& geometry)
     ScopedPushPop spp(*this, geometry.getStateSet());
 
     uint32_t geometryMask = (osg2vsg::calculateAttributesMask(&geometry) | buildOptions->overrideGeomAttributes) & buildOptions->supportedGeometryAttributes;
+    if (buildOptions->interleavedArrays) geometryMask |= INTERLEAVED;
+    if (buildOptions->quantizeArrays) geometryMask |= QUANTIZED;
     uint32_t shaderModeMask = (calculateShaderModeMask() | buildOptions->overrideShaderModeMask | nodeShaderModeMasks) & buildOptions->supportedShaderModeMask;
     bool requiredBlending = (shaderModeMask & BLEND) != 0;
 
     // std::cout<<"Have geometry with "<<statestack.size()<<" shaderModeMask="<<shaderModeMask<<", geometryMask="<<geometryMask<<std::endl;
 
-    auto vsg_geometry = osg2vsg::convertToVsg(&geometry, geometryMask, buildOptions->geometryTarget);
+    vsg::ref_ptr<vsg::Node> vsg_geometry = createSpatialChunks(geometry, geometryMask, !requiredBlending);
+    if (!vsg_geometry) vsg_geometry = createLODs(osg2vsg::convertToVsg(&geometry, geometryMask, *buildOptions, !requiredBlending), *buildOptions);
     if (!vsg_geometry)
     {
         return;
@@ -240,14 +798,23 @@ void ConvertToVsg::apply(osg::Geometry& geometry)
 
     stategroup->addChild(vsg_geometry);
 
-    if (requiredBlending && buildOptions->useDepthSorted)
+    bool requiresBound = (requiredBlending && buildOptions->useDepthSorted) || buildOptions->insertCullGroups || buildOptions->insertCullNodes;
+    vsg::dsphere bound;
+    if (requiresBound)
     {
         auto center = geometry.getBound().center();
         auto radius = geometry.getBound().radius();
+        bound.set(center.x(), center.y(), center.z(), radius);
+
+        // vertices translated per instance by the billboard positions aren't bounded by the converted vertices
+        if (buildOptions->tightBounds && (nodeShaderModeMasks & SHADER_TRANSLATE) == 0) bound = computeTightBound(*vsg_geometry, bound, buildOptions->statistics.get());
+    }
 
+    if (requiredBlending && buildOptions->useDepthSorted)
+    {
         auto depthSorted = vsg::DepthSorted::create();
         depthSorted->binNumber = 10;
-        depthSorted->bound.set(center.x(), center.y(), center.z(), radius);
+        depthSorted->bound = bound;
         depthSorted->child = stategroup;
 
         root = depthSorted;
@@ -256,10 +823,7 @@ void ConvertToVsg::apply(osg::Geometry& geometry)
     {
         if (buildOptions->insertCullGroups || buildOptions->insertCullNodes)
         {
-            auto center = geometry.getBound().center();
-            auto radius = geometry.getBound().radius();
-
-            root = vsg::CullNode::create(vsg::dsphere(center.x(), center.y(), center.z(), radius), stategroup);
+            root = vsg::CullNode::create(bound, stategroup);
         }
         else
         {
@@ -282,13 +846,13 @@ void ConvertToVsg::apply(osg::Group& group)
 
     //vsg_group->setValue("class", group.className());
 
-    for (unsigned int i = 0; i < group.getNumChildren(); ++i)
+    auto instancedGroup = createInstancedGroup(group);
+    auto batchedGroup = createBatchedGroup(instancedGroup ? *instancedGroup : group);
+    auto& children = batchedGroup ? *batchedGroup : (instancedGroup ? *instancedGroup : group);
+
+    for (auto& vsg_child : convertChildren(children, children.getNumChildren()))
     {
-        auto child = group.getChild(i);
-        if (auto vsg_child = convert(child); vsg_child)
-        {
-            vsg_group->addChild(vsg_child);
-        }
+        if (vsg_child) vsg_group->addChild(vsg_child);
     }
 
     root = vsg_group;
@@ -301,13 +865,13 @@ void ConvertToVsg::apply(osg::MatrixTransform& transform)
     auto vsg_transform = vsg::MatrixTransform::create();
     vsg_transform->matrix = osg2vsg::convert(transform.getMatrix());
 
-    for (unsigned int i = 0; i < transform.getNumChildren(); ++i)
+    auto instancedGroup = createInstancedGroup(transform);
+    auto batchedGroup = createBatchedGroup(instancedGroup ? *instancedGroup : static_cast<osg::Group&>(transform));
+    auto& children = batchedGroup ? *batchedGroup : (instancedGroup ? *instancedGroup : static_cast<osg::Group&>(transform));
+
+    for (auto& vsg_child : convertChildren(children, children.getNumChildren()))
     {
-        auto child = transform.getChild(i);
-        if (auto vsg_child = convert(child); vsg_child)
-        {
-            vsg_transform->addChild(vsg_child);
-        }
+        if (vsg_child) vsg_transform->addChild(vsg_child);
     }
 
     struct CheckForCullNodes : public vsg::ConstVisitor
@@ -431,7 +995,11 @@ void ConvertToVsg::apply(osg::Billboard& billboard)
             osg::Geometry* geometry = child->asGeometry();
             if (geometry)
             {
+                // the drawable is modified in place so serialize access when converting in parallel
+                std::lock_guard<std::mutex> guard(shared().billboardMutex);
+
                 geometry->setComputeBoundingBoxCallback(new ComputeBillboardBoundingBox(positions));
+                geometry->dirtyBound(); // a drawable shared by several billboards gets the bound of each one's positions in turn
 
                 osg::ref_ptr<osg::Vec3Array> positionArray = new osg::Vec3Array(positions.begin(), positions.end());
                 positionArray->setBinding(osg::Array::BIND_OVERALL);
@@ -491,9 +1059,22 @@ void ConvertToVsg::apply(osg::LOD& lod)
 
     // build a map of minimum screen ratio to child
     std::map<double, vsg::ref_ptr<vsg::Node>> ratioChildMap;
+    auto vsg_children = convertChildren(lod, numChildren);
+
+    // tighten the bound around the converted children before the distance ranges are turned into screen ratios of its radius, so the switch distances are kept
+    if (buildOptions->tightBounds && lod.getCenterMode() != osg::LOD::USER_DEFINED_CENTER && lod.getRadius() <= 0.0 && lod.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT)
+    {
+        CollectVertices collectVertices;
+        for (auto& vsg_child : vsg_children)
+        {
+            if (vsg_child) vsg_child->accept(collectVertices);
+        }
+        vsg_lod->bound = computeTightBound(collectVertices, vsg_lod->bound, buildOptions->statistics.get());
+        radius = vsg_lod->bound.radius;
+    }
     for (unsigned int i = 0; i < numChildren; ++i)
     {
-        if (auto vsg_child = convert(lod.getChild(i)); vsg_child)
+        if (auto vsg_child = vsg_children[i]; vsg_child)
         {
             double minimumScreenHeightRatio = (lod.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT) ? (atan2(radius, static_cast<double>(lod.getMaxRange(i))) * angle_ratio) : (lod.getMinRange(i) * pixel_ratio);
 
@@ -512,7 +1093,11 @@ void ConvertToVsg::apply(osg::LOD& lod)
 
 void ConvertToVsg::apply(osg::PagedLOD& plod)
 {
-    ++numOfPagedLOD;
+    {
+        auto& caches = shared();
+        std::lock_guard<std::mutex> guard(caches.cacheMutex);
+        ++caches.numOfPagedLOD;
+    }
 
     auto vsg_lod = vsg::PagedLOD::create();
 
@@ -552,10 +1137,12 @@ void ConvertToVsg::apply(osg::PagedLOD& plod)
     using Children = std::vector<Child>;
     Children children;
 
+    auto vsg_children = convertChildren(plod, std::min(numChildren, numRanges));
+
     for (unsigned int i = 0; i < numRanges; ++i)
     {
         vsg::ref_ptr<vsg::Node> vsg_child;
-        if (i < numChildren) vsg_child = convert(plod.getChild(i));
+        if (i < vsg_children.size()) vsg_child = vsg_children[i];
 
         double minimumScreenHeightRatio = (plod.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT) ? (atan2(radius, static_cast<double>(plod.getMaxRange(i))) * angle_ratio) : (plod.getMinRange(i) * pixel_ratio);
 
@@ -581,9 +1168,10 @@ void ConvertToVsg::apply(osg::Switch& sw)
 {
     auto vsg_sw = vsg::Switch::create();
 
+    auto vsg_children = convertChildren(sw, sw.getNumChildren());
     for (unsigned int i = 0; i < sw.getNumChildren(); ++i)
     {
-        auto vsg_child = convert(sw.getChild(i));
+        auto vsg_child = vsg_children[i];
         if (vsg_child)
         {
             vsg_sw->addChild(sw.getValue(i), vsg_child);
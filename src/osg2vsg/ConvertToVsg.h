@@ -14,6 +14,8 @@
 #include "SceneBuilder.h"
 #include "ShaderUtils.h"
 
+#include <future>
+
 namespace osg2vsg
 {
 
@@ -22,6 +24,8 @@ namespace osg2vsg
     class ConvertToVsg : public osg::NodeVisitor, public osg2vsg::SceneBuilderBase
     {
     public:
+        using NodeContext = std::pair<StateStack, uint32_t>;
+
         ConvertToVsg(vsg::ref_ptr<const BuildOptions> options, vsg::ref_ptr<vsg::StateGroup> in_inheritedStateGroup = {}) :
             osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
             SceneBuilderBase(options),
@@ -29,6 +33,9 @@ namespace osg2vsg
         {
         }
 
+        /// per task converter used by parallel conversion, starts with the state stack and node shader mode masks of context and shares the caches of the top level converter
+        ConvertToVsg(ConvertToVsg& parent, const NodeContext& context);
+
         vsg::ref_ptr<vsg::Node> root;
 
         using osg::NodeVisitor::apply;
@@ -40,6 +47,17 @@ namespace osg2vsg
         using NodeMap = std::map<osg::Node*, vsg::ref_ptr<vsg::Node>>;
         NodeMap nodeMap;
 
+        // parallel conversion support, taskPool is only assigned when BuildOptions::parallelConversion is enabled.
+        using PendingNodeMap = std::map<osg::Node*, std::shared_future<vsg::ref_ptr<vsg::Node>>>;
+        using NodeContextMap = std::map<osg::Node*, NodeContext>;
+
+        vsg::ref_ptr<TaskPool> taskPool;
+        PendingNodeMap pendingNodes;
+        NodeContextMap sharedNodeContexts;
+        std::mutex billboardMutex;
+
+        ConvertToVsg& shared() { return cacheOwner ? static_cast<ConvertToVsg&>(*cacheOwner) : *this; }
+
         size_t numOfPagedLOD = 0;
         FileNameMap filenameMap;
 
@@ -51,11 +69,34 @@ namespace osg2vsg
 
         void optimize(osg::Node* osg_scene);
 
+        /// set up the taskPool and record the state each shared node is first reached with, so parallel conversion reproduces the serial results.
+        void setUpParallelConversion(osg::Node* osg_scene);
+
         vsg::ref_ptr<vsg::Node> convert(osg::Node* node);
 
+        /// convert the children [0, numChildren) of group, using the taskPool when parallel conversion is enabled, results are returned in child order.
+        std::vector<vsg::ref_ptr<vsg::Node>> convertChildren(osg::Group& group, unsigned int numChildren);
+
+        /// when BuildOptions::batchSmallGeometries is set, return a copy of group's child list with the geometries that share pipeline and descriptor state
+        /// merged into batches of at most BuildOptions::maxBatchVertices vertices, returns null when there is nothing to merge.
+        osg::ref_ptr<osg::Group> createBatchedGroup(osg::Group& group);
+
+        /// when BuildOptions::chunkLargeGeometries is set and geometry exceeds maxChunkTriangles or maxChunkExtent, return a CullGroup hierarchy
+        /// with a CullNode and draw for each spatial chunk of the geometry, otherwise return null.
+        vsg::ref_ptr<vsg::Node> createSpatialChunks(osg::Geometry& geometry, uint32_t geometryMask, bool opaque);
+
+        /// when BuildOptions::instanceRepeatedGeometries is set, return a copy of group's child list with each geometry repeated under at least
+        /// BuildOptions::minInstanceCount static MatrixTransform children replaced by one instanced geometry, returns null when there is nothing to instance.
+        osg::ref_ptr<osg::Group> createInstancedGroup(osg::Group& group);
+
+        // geometries and transforms created by createBatchedGroup() and createInstancedGroup(), kept so their addresses remain unique keys in nodeMap
+        std::vector<osg::ref_ptr<osg::Node>> createdNodes;
+
         template<class V>
         vsg::ref_ptr<V> copyArray(const osg::Array* array)
         {
+            if (buildOptions->zeroCopyArrays) return adopt<V>(*array);
+
             vsg::ref_ptr<V> new_array = V::create(array->getNumElements());
 
             std::memcpy(new_array->dataPointer(), array->getDataPointer(), array->getTotalDataSize());
@@ -96,4 +137,13 @@ namespace osg2vsg
         void apply(osgTerrain::TerrainTile& terrainTile);
     };
 
+    /// callback returning a TaskPool with numThreads workers, used to reuse one pool across conversions rather than starting and joining threads for each.
+    using GetOrCreateTaskPool = std::function<vsg::ref_ptr<TaskPool>(uint32_t numThreads)>;
+
+    /// convert node using the PipelineCache assigned to options as OSG::pipeline_cache, otherwise pipelineCache, or when both are null a new PipelineCache.
+    /// PipelineCache is thread safe so one cache can be shared by concurrent reads such as those made by vsg::DatabasePager threads.
+    /// When a TaskPool is required the one assigned to BuildOptions::taskPool is used, otherwise the one assigned to options as OSG::task_pool,
+    /// otherwise the one returned by getOrCreateTaskPool, or when that is empty a new TaskPool.
+    vsg::ref_ptr<vsg::Node> convert(const osg::Node& node, vsg::ref_ptr<const vsg::Options> options, vsg::ref_ptr<PipelineCache> pipelineCache, GetOrCreateTaskPool getOrCreateTaskPool = {});
+
 } // namespace osg2vsg
@@ -11,106 +11,141 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 </editor-fold> */
 
 #include "GeometryUtils.h"
+#include "BoundingSphere.h"
+#include "BuildOptions.h"
 #include "ImageUtils.h"
+#include "MeshOptimizer.h"
 #include "ShaderUtils.h"
 
 #include <osg/TemplatePrimitiveIndexFunctor>
+#include <osg/TriangleIndexFunctor>
 #include <osgUtil/MeshOptimizers>
-#include <osgUtil/TangentSpaceGenerator>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
 
 namespace osg2vsg
 {
 
-    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2Array* inarray, uint32_t bindOverallPaddingCount)
+    // convert the osg array to a vsg array in bulk, the osg and vsg vector types share the same layout so float arrays are a straight memcpy,
+    // and double arrays are narrowed as a flat run of scalars that the compiler can vectorize. Elements between the end of inarray
+    // and bindOverallPaddingCount are filled with the last value. With zeroCopy float arrays that need no padding share inarray's storage.
+    template<class OutArray, class InArray>
+    vsg::ref_ptr<OutArray> convertArray(const InArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
     {
-        if (!inarray) return vsg::ref_ptr<vsg::vec2Array>();
+        using in_value_type = typename InArray::ElementDataType;
+        using out_value_type = typename OutArray::value_type;
+        using in_scalar_type = typename in_value_type::value_type;
+        using out_scalar_type = typename out_value_type::value_type;
+        static_assert(sizeof(in_value_type) == in_value_type::num_components * sizeof(in_scalar_type), "osg vector must be tightly packed");
+        static_assert(sizeof(out_value_type) == in_value_type::num_components * sizeof(out_scalar_type), "vsg vector must match the osg vector's components");
 
         uint32_t count = inarray->size();
         uint32_t targetSize = std::max(count, bindOverallPaddingCount);
 
-        vsg::ref_ptr<vsg::vec2Array> outarray(new vsg::vec2Array(targetSize));
-        uint32_t i = 0;
-        for (; i < count; ++i)
+        if constexpr (std::is_same_v<in_scalar_type, out_scalar_type>)
         {
-            const osg::Vec2& in_value = inarray->at(i);
-            outarray->at(i) = vsg::vec2(in_value.x(), in_value.y());
+            if (zeroCopy && count == targetSize) return adopt<OutArray>(*inarray);
         }
 
-        if (i < bindOverallPaddingCount)
+        auto outarray = OutArray::create(targetSize);
+        if (count == 0) return outarray;
+
+        auto out = outarray->data();
+        if constexpr (std::is_same_v<in_scalar_type, out_scalar_type>)
+        {
+            std::memcpy(out, inarray->getDataPointer(), count * sizeof(out_value_type));
+        }
+        else
         {
-            auto last = outarray->at(count - 1);
-            for (; i < bindOverallPaddingCount; ++i)
+            auto src = static_cast<const in_scalar_type*>(inarray->getDataPointer());
+            auto dst = reinterpret_cast<out_scalar_type*>(out);
+            size_t numScalars = size_t(count) * in_value_type::num_components;
+            for (size_t i = 0; i < numScalars; ++i)
             {
-                outarray->at(i) = last;
+                dst[i] = static_cast<out_scalar_type>(src[i]);
             }
         }
 
+        std::fill(out + count, out + targetSize, out[count - 1]);
+
         return outarray;
     }
 
-    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3Array* inarray, uint32_t bindOverallPaddingCount)
+    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
     {
-        if (!inarray || inarray->size() == 0) return vsg::ref_ptr<vsg::vec3Array>();
+        if (!inarray) return vsg::ref_ptr<vsg::vec2Array>();
+        return convertArray<vsg::vec2Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        uint32_t count = inarray->size();
-        uint32_t targetSize = std::max(count, bindOverallPaddingCount);
+    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray || inarray->size() == 0) return vsg::ref_ptr<vsg::vec3Array>();
+        return convertArray<vsg::vec3Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        vsg::ref_ptr<vsg::vec3Array> outarray(new vsg::vec3Array(targetSize));
-        uint32_t i = 0;
-        for (; i < count; ++i)
-        {
-            const osg::Vec3& in_value = inarray->at(i);
-            outarray->at(i) = vsg::vec3(in_value.x(), in_value.y(), in_value.z());
-        }
+    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray) return vsg::ref_ptr<vsg::vec4Array>();
+        return convertArray<vsg::vec4Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        if (i < bindOverallPaddingCount)
-        {
-            auto last = outarray->at(count - 1);
-            for (; i < bindOverallPaddingCount; ++i)
-            {
-                outarray->at(i) = last;
-            }
-        }
+    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray) return vsg::ref_ptr<vsg::vec2Array>();
+        return convertArray<vsg::vec2Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        return outarray;
+    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray || inarray->size() == 0) return vsg::ref_ptr<vsg::vec3Array>();
+        return convertArray<vsg::vec3Array>(inarray, bindOverallPaddingCount, zeroCopy);
     }
 
-    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4Array* inarray, uint32_t bindOverallPaddingCount)
+    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
     {
         if (!inarray) return vsg::ref_ptr<vsg::vec4Array>();
+        return convertArray<vsg::vec4Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        uint32_t count = inarray->size();
-        uint32_t targetSize = std::max(count, bindOverallPaddingCount);
+    vsg::ref_ptr<vsg::ubvec4Array> convertToVsg(const osg::Vec4ubArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray) return vsg::ref_ptr<vsg::ubvec4Array>();
+        return convertArray<vsg::ubvec4Array>(inarray, bindOverallPaddingCount, zeroCopy);
+    }
 
-        vsg::ref_ptr<vsg::vec4Array> outarray(new vsg::vec4Array(targetSize));
-        uint32_t i = 0;
-        for (; i < count; ++i)
-        {
-            const osg::Vec4& in_value = inarray->at(i);
-            outarray->at(i) = vsg::vec4(in_value.x(), in_value.y(), in_value.z(), in_value.w());
-        }
+    vsg::ref_ptr<vsg::mat4Array> convertToVsg(const osg::MatrixfArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
+    {
+        if (!inarray || inarray->size() == 0) return vsg::ref_ptr<vsg::mat4Array>();
 
-        if (i < bindOverallPaddingCount)
-        {
-            auto last = outarray->at(count - 1);
-            for (; i < bindOverallPaddingCount; ++i)
-            {
-                outarray->at(i) = last;
-            }
-        }
+        // osg::Matrixf and vsg::mat4 share the same memory layout
+        uint32_t count = inarray->size();
+        uint32_t targetSize = std::max(count, bindOverallPaddingCount);
+        if (zeroCopy && count == targetSize) return adopt<vsg::mat4Array>(*inarray);
 
+        auto outarray = vsg::mat4Array::create(targetSize);
+        std::memcpy(outarray->dataPointer(), inarray->getDataPointer(), count * sizeof(vsg::mat4));
+        std::fill(outarray->begin() + count, outarray->end(), outarray->at(count - 1));
         return outarray;
     }
 
-    vsg::ref_ptr<vsg::Data> convertToVsg(const osg::Array* inarray, uint32_t bindOverallPaddingCount)
+    vsg::ref_ptr<vsg::Data> convertToVsg(const osg::Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy)
     {
         if (!inarray) return vsg::ref_ptr<vsg::Data>();
 
         switch (inarray->getType())
         {
-        case osg::Array::Type::Vec2ArrayType: return convertToVsg(dynamic_cast<const osg::Vec2Array*>(inarray), bindOverallPaddingCount);
-        case osg::Array::Type::Vec3ArrayType: return convertToVsg(dynamic_cast<const osg::Vec3Array*>(inarray), bindOverallPaddingCount);
-        case osg::Array::Type::Vec4ArrayType: return convertToVsg(dynamic_cast<const osg::Vec4Array*>(inarray), bindOverallPaddingCount);
+        case osg::Array::Type::Vec2ArrayType: return convertToVsg(dynamic_cast<const osg::Vec2Array*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec3ArrayType: return convertToVsg(dynamic_cast<const osg::Vec3Array*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec4ArrayType: return convertToVsg(dynamic_cast<const osg::Vec4Array*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec2dArrayType: return convertToVsg(dynamic_cast<const osg::Vec2dArray*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec3dArrayType: return convertToVsg(dynamic_cast<const osg::Vec3dArray*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec4dArrayType: return convertToVsg(dynamic_cast<const osg::Vec4dArray*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::Vec4ubArrayType: return convertToVsg(dynamic_cast<const osg::Vec4ubArray*>(inarray), bindOverallPaddingCount, zeroCopy);
+        case osg::Array::Type::MatrixArrayType: return convertToVsg(dynamic_cast<const osg::MatrixfArray*>(inarray), bindOverallPaddingCount, zeroCopy);
         default: return vsg::ref_ptr<vsg::Data>();
         }
     }
@@ -146,6 +181,11 @@ namespace osg2vsg
             if (geometry->getVertexAttribBinding(7) == osg::Geometry::AttributeBinding::BIND_OVERALL) mask |= TRANSLATE_OVERALL;
         }
 
+        if (auto matrices = geometry->getVertexAttribArray(8); matrices && matrices->getType() == osg::Array::MatrixArrayType && matrices->getBinding() == osg::Array::BIND_OVERALL)
+        {
+            mask |= INSTANCE_MATRIX;
+        }
+
         if (geometry->getTexCoordArray(0) != nullptr) mask |= TEXCOORD0;
         if (geometry->getTexCoordArray(1) != nullptr) mask |= TEXCOORD1;
         if (geometry->getTexCoordArray(2) != nullptr) mask |= TEXCOORD2;
@@ -290,69 +330,522 @@ namespace osg2vsg
         }
     };
 
-    vsg::ref_ptr<vsg::Command> convertToVsg(osg::Geometry* ingeometry, uint32_t requiredAttributesMask, GeometryTarget geometryTarget)
+    // largest number of vertices to address with 16 bit indices, leaving 0xffff free for use as the primitive restart index
+    const uint32_t maxUShortIndexedVertices = 65535;
+
+    template<class A>
+    vsg::ref_ptr<vsg::Data> createIndexArray(const std::vector<uint32_t>& indices)
     {
-        uint32_t instanceCount = 1;
+        auto array = A::create(static_cast<uint32_t>(indices.size()));
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            array->set(i, static_cast<typename A::value_type>(indices[i]));
+        }
+        return array;
+    }
 
-        // work out if we need to enable instancing by looking at BIND_OVERALL entries
-        // to see if any have more than one element which we'll interpret as requesting instancing, such as for our custom osg::Billboard handling.
+    // create the smallest index array type able to address vertexCount vertices, ubyte indices require the VK_EXT_index_type_uint8 extension so are only used when uint8Indices is set.
+    vsg::ref_ptr<vsg::Data> createIndices(const std::vector<uint32_t>& indices, size_t vertexCount, bool uint8Indices)
+    {
+        if (uint8Indices && vertexCount <= 256) return createIndexArray<vsg::ubyteArray>(indices);
+        if (vertexCount <= maxUShortIndexedVertices) return createIndexArray<vsg::ushortArray>(indices);
+        return createIndexArray<vsg::uintArray>(indices);
+    }
+
+    struct TriangleChunk
+    {
+        std::vector<uint32_t> vertices; // original index of each of the chunk's vertices
+        std::vector<uint32_t> indices;  // triangle indices into vertices
+    };
+
+    // partition the triangles, in their original order, into chunks that each reference at most maxVertices vertices
+    std::vector<TriangleChunk> splitTriangles(const std::vector<uint32_t>& triangles, size_t vertexCount, uint32_t maxVertices)
+    {
+        const uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> chunkOfVertex(vertexCount, unassigned);
+        std::vector<uint32_t> localIndex(vertexCount, 0);
+
+        std::vector<TriangleChunk> chunks(1);
+        for (size_t t = 0; t + 2 < triangles.size(); t += 3)
         {
-            osg::Geometry::ArrayList arrays;
-            if (ingeometry->getArrayList(arrays))
+            uint32_t currentChunk = static_cast<uint32_t>(chunks.size() - 1);
+
+            size_t numNewVertices = 0;
+            for (size_t i = t; i < t + 3; ++i)
             {
-                for (auto& array : arrays)
+                if (chunkOfVertex[triangles[i]] != currentChunk) ++numNewVertices;
+            }
+
+            if (chunks.back().vertices.size() + numNewVertices > maxVertices)
+            {
+                chunks.emplace_back();
+                ++currentChunk;
+            }
+
+            auto& chunk = chunks.back();
+            for (size_t i = t; i < t + 3; ++i)
+            {
+                uint32_t index = triangles[i];
+                if (chunkOfVertex[index] != currentChunk)
                 {
-                    if (array->getBinding() == osg::Array::BIND_OVERALL)
-                    {
-                        if (instanceCount < array->getNumElements()) instanceCount = array->getNumElements();
-                    }
+                    chunkOfVertex[index] = currentChunk;
+                    localIndex[index] = static_cast<uint32_t>(chunk.vertices.size());
+                    chunk.vertices.push_back(index);
                 }
+                chunk.indices.push_back(localIndex[index]);
             }
         }
 
-        uint32_t bindOverallPaddingCount = instanceCount;
+        return chunks;
+    }
 
-        // convert attribute arrays, create defaults for any requested attributes that don't exist for now to ensure pipeline gets required data
-        vsg::ref_ptr<vsg::Data> vertices(osg2vsg::convertToVsg(ingeometry->getVertexArray(), bindOverallPaddingCount));
-        if (!vertices.valid() || vertices->valueCount() == 0) return {};
+    template<class A>
+    vsg::ref_ptr<vsg::Data> gatherArray(const A& source, const std::vector<uint32_t>& vertices)
+    {
+        auto array = A::create(static_cast<uint32_t>(vertices.size()));
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            array->set(i, source.at(vertices[i]));
+        }
+        return array;
+    }
 
-        // normals
-        vsg::ref_ptr<vsg::Data> normals(osg2vsg::convertToVsg(ingeometry->getNormalArray(), bindOverallPaddingCount));
+    // copy the values of the listed vertices into a new array of the same type, returns null for unsupported array types.
+    vsg::ref_ptr<vsg::Data> gatherVertices(const vsg::ref_ptr<vsg::Data>& data, const std::vector<uint32_t>& vertices)
+    {
+        if (auto vec2s = data.cast<vsg::vec2Array>()) return gatherArray(*vec2s, vertices);
+        if (auto vec3s = data.cast<vsg::vec3Array>()) return gatherArray(*vec3s, vertices);
+        if (auto vec4s = data.cast<vsg::vec4Array>()) return gatherArray(*vec4s, vertices);
+        if (auto svec2s = data.cast<vsg::svec2Array>()) return gatherArray(*svec2s, vertices);
+        if (auto svec4s = data.cast<vsg::svec4Array>()) return gatherArray(*svec4s, vertices);
+        if (auto usvec2s = data.cast<vsg::usvec2Array>()) return gatherArray(*usvec2s, vertices);
+        if (auto ubvec4s = data.cast<vsg::ubvec4Array>()) return gatherArray(*ubvec4s, vertices);
+        return {};
+    }
 
-        // tangents
-        vsg::ref_ptr<vsg::Data> tangents(osg2vsg::convertToVsg(ingeometry->getVertexAttribArray(6), bindOverallPaddingCount));
-        if ((!tangents.valid() || tangents->valueCount() == 0) && (requiredAttributesMask & TANGENT))
+    // pack the per vertex arrays that follow the vertices into a single interleaved array, in the order matching the INTERLEAVED VertexInputState
+    // created by PipelineCache. The vertices keep their own array so bounds can still be computed from them, and per instance arrays keep theirs.
+    vsg::DataList interleaveArrays(const vsg::DataList& arrays, const std::vector<bool>& perVertex)
+    {
+        uint32_t vertexCount = arrays[0]->valueCount();
+
+        uint32_t stride = 0;
+        bool mismatchedSizes = false;
+        for (size_t i = 1; i < arrays.size(); ++i)
         {
-            osg::ref_ptr<osgUtil::TangentSpaceGenerator> tangentSpaceGenerator = new osgUtil::TangentSpaceGenerator();
-            tangentSpaceGenerator->generate(ingeometry, 0);
+            if (!perVertex[i]) continue;
+            stride += static_cast<uint32_t>(arrays[i]->valueSize());
+            if (arrays[i]->valueCount() < vertexCount) mismatchedSizes = true;
+        }
 
-            osg::Vec4Array* tangentArray = tangentSpaceGenerator->getTangentArray();
-            //osg::Vec4Array* biNormalArray = tangGen->getBinormalArray();
+        vsg::DataList interleavedArrays{arrays[0]};
+        if (stride > 0)
+        {
+            auto interleaved = vsg::ubyteArray::create(vertexCount * stride);
+            auto dest = interleaved->data();
+            if (mismatchedSizes) std::memset(dest, 0, interleaved->dataSize());
 
-            if (tangentArray && tangentArray->size() > 0)
+            size_t offset = 0;
+            for (size_t i = 1; i < arrays.size(); ++i)
             {
-                tangents = osg2vsg::convertToVsg(tangentArray, bindOverallPaddingCount);
-                // bind them to the osg geometry too??
-                ingeometry->setVertexAttribArray(6, tangentArray);
-                ingeometry->setVertexAttribBinding(6, osg::Geometry::BIND_PER_VERTEX);
+                if (!perVertex[i]) continue;
+
+                auto& array = arrays[i];
+                size_t valueSize = array->valueSize();
+                uint32_t count = std::min(static_cast<uint32_t>(array->valueCount()), vertexCount);
+                for (uint32_t v = 0; v < count; ++v)
+                {
+                    std::memcpy(dest + v * stride + offset, array->dataPointer(v), valueSize);
+                }
+                offset += valueSize;
             }
+            interleavedArrays.push_back(interleaved);
         }
 
-        // colors
-        vsg::ref_ptr<vsg::Data> colors(osg2vsg::convertToVsg(ingeometry->getColorArray(), bindOverallPaddingCount));
+        for (size_t i = 1; i < arrays.size(); ++i)
+        {
+            if (!perVertex[i]) interleavedArrays.push_back(arrays[i]);
+        }
 
-        // tex0
-        vsg::ref_ptr<vsg::Data> texcoord0(osg2vsg::convertToVsg(ingeometry->getTexCoordArray(0), bindOverallPaddingCount));
+        return interleavedArrays;
+    }
 
-        vsg::ref_ptr<vsg::Data> translations(osg2vsg::convertToVsg(ingeometry->getVertexAttribArray(7), bindOverallPaddingCount));
+    // round v, clamped to [-1, 1], to the nearest 16 bit snorm value
+    int16_t toSnorm16(float v)
+    {
+        return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+    }
 
-        // fill arrays data list THE ORDER HERE IS IMPORTANT
-        auto attributeArrays = vsg::DataList{vertices}; // always have vertices
-        if (normals.valid() && normals->valueCount() > 0) attributeArrays.push_back(normals);
-        if (tangents.valid() && tangents->valueCount() > 0) attributeArrays.push_back(tangents);
-        if (colors.valid() && colors->valueCount() > 0) attributeArrays.push_back(colors);
-        if (texcoord0.valid() && texcoord0->valueCount() > 0) attributeArrays.push_back(texcoord0);
-        if (translations.valid() && translations->valueCount() > 0) attributeArrays.push_back(translations);
+    // project a unit vector onto the octahedron |x| + |y| + |z| = 1 and unfold the lower half into the [-1, 1] square, decoded by octDecode() in the vertex shader
+    vsg::vec2 octEncode(const vsg::vec3& v)
+    {
+        float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 == 0.0f) return vsg::vec2(0.0f, 0.0f);
+
+        vsg::vec2 p(v.x / l1, v.y / l1);
+        if (v.z < 0.0f)
+        {
+            float sx = p.x >= 0.0f ? 1.0f : -1.0f;
+            float sy = p.y >= 0.0f ? 1.0f : -1.0f;
+            p.set((1.0f - std::abs(p.y)) * sx, (1.0f - std::abs(p.x)) * sy);
+        }
+        return p;
+    }
+
+    // convert to the bits of the nearest IEEE 754 half float, overflowing to infinity and flushing values below the smallest denormal to zero
+    uint16_t floatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+        uint32_t exponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (exponent == 0xff) return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0); // infinity or NaN
+
+        int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+        if (halfExponent >= 31) return sign | 0x7c00;
+
+        if (halfExponent <= 0)
+        {
+            if (halfExponent < -10) return sign;
+
+            // denormal, include the implicit leading bit and shift it down
+            mantissa |= 0x800000;
+            uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1) ++half;
+            return sign | static_cast<uint16_t>(half);
+        }
+
+        // a carry out of the mantissa when rounding correctly increments the exponent
+        uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000) ++half;
+        return sign | static_cast<uint16_t>(half);
+    }
+
+    template<class OutArray, class InArray, class F>
+    vsg::ref_ptr<vsg::Data> transformArray(const InArray& inarray, F convert)
+    {
+        auto outarray = OutArray::create(static_cast<uint32_t>(inarray.size()));
+        auto out = outarray->begin();
+        for (auto& value : inarray) *out++ = convert(value);
+        return outarray;
+    }
+
+    // widen any of the vector arrays created by convertToVsg(const osg::Array*, ..) to vec4s, filling missing components with 0 and a missing w with 1
+    vsg::ref_ptr<vsg::vec4Array> toVec4Array(const vsg::Data& data)
+    {
+        auto widen = [](const auto& array, auto toVec4) {
+            auto vec4s = vsg::vec4Array::create(static_cast<uint32_t>(array.size()));
+            auto out = vec4s->begin();
+            for (auto& value : array) *out++ = toVec4(value);
+            return vec4s;
+        };
+
+        if (auto vec2s = dynamic_cast<const vsg::vec2Array*>(&data)) return widen(*vec2s, [](const vsg::vec2& v) { return vsg::vec4(v.x, v.y, 0.0f, 1.0f); });
+        if (auto vec3s = dynamic_cast<const vsg::vec3Array*>(&data)) return widen(*vec3s, [](const vsg::vec3& v) { return vsg::vec4(v.x, v.y, v.z, 1.0f); });
+        if (auto vec4s = dynamic_cast<const vsg::vec4Array*>(&data)) return widen(*vec4s, [](const vsg::vec4& v) { return v; });
+        if (auto dvec2s = dynamic_cast<const vsg::dvec2Array*>(&data)) return widen(*dvec2s, [](const vsg::dvec2& v) { return vsg::vec4(float(v.x), float(v.y), 0.0f, 1.0f); });
+        if (auto dvec3s = dynamic_cast<const vsg::dvec3Array*>(&data)) return widen(*dvec3s, [](const vsg::dvec3& v) { return vsg::vec4(float(v.x), float(v.y), float(v.z), 1.0f); });
+        if (auto dvec4s = dynamic_cast<const vsg::dvec4Array*>(&data)) return widen(*dvec4s, [](const vsg::dvec4& v) { return vsg::vec4(float(v.x), float(v.y), float(v.z), float(v.w)); });
+        if (auto ubvec4s = dynamic_cast<const vsg::ubvec4Array*>(&data)) return widen(*ubvec4s, [](const vsg::ubvec4& c) { return vsg::vec4(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f); });
+        return {};
+    }
+
+    // convert data to the float array type A that the pipeline declares for its attribute, data already of that type is returned unchanged
+    template<class A>
+    vsg::ref_ptr<vsg::Data> convertToFormat(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        if (!data || data.cast<A>()) return data;
+
+        auto vec4s = toVec4Array(*data);
+        if (!vec4s) return {};
+
+        if constexpr (std::is_same_v<A, vsg::vec4Array>)
+        {
+            return vec4s;
+        }
+        else
+        {
+            return transformArray<A>(*vec4s, [](const vsg::vec4& v) {
+                typename A::value_type value;
+                for (size_t c = 0; c < value.size(); ++c) value[c] = v[c];
+                return value;
+            });
+        }
+    }
+
+    // the quantize functions convert other vector types to the float type they encode first, as the QUANTIZED pipeline declares the quantized formats
+    // whatever the source type. Only arrays that are already quantized, which convertToFormat() doesn't accept, pass straight through.
+
+    vsg::ref_ptr<vsg::Data> quantizeNormals(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        auto normals = convertToFormat<vsg::vec3Array>(data).cast<vsg::vec3Array>();
+        if (!normals) return data;
+
+        return transformArray<vsg::svec2Array>(*normals, [](const vsg::vec3& n) {
+            auto p = octEncode(n);
+            return vsg::svec2(toSnorm16(p.x), toSnorm16(p.y));
+        });
+    }
+
+    // the tangent direction is octahedral encoded in xy, with the handedness in w
+    vsg::ref_ptr<vsg::Data> quantizeTangents(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        auto tangents = convertToFormat<vsg::vec4Array>(data).cast<vsg::vec4Array>();
+        if (!tangents) return data;
+
+        return transformArray<vsg::svec4Array>(*tangents, [](const vsg::vec4& t) {
+            auto p = octEncode(vsg::vec3(t.x, t.y, t.z));
+            return vsg::svec4(toSnorm16(p.x), toSnorm16(p.y), 0, t.w < 0.0f ? -32767 : 32767);
+        });
+    }
+
+    vsg::ref_ptr<vsg::Data> quantizeColors(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        if (data.cast<vsg::ubvec4Array>()) return data;
+
+        auto colors = convertToFormat<vsg::vec4Array>(data).cast<vsg::vec4Array>();
+        if (!colors) return data;
+
+        auto toUnorm8 = [](float v) { return static_cast<uint8_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f)); };
+        return transformArray<vsg::ubvec4Array>(*colors, [&](const vsg::vec4& c) {
+            return vsg::ubvec4(toUnorm8(c.r), toUnorm8(c.g), toUnorm8(c.b), toUnorm8(c.a));
+        });
+    }
+
+    vsg::ref_ptr<vsg::Data> quantizeTexCoords(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        auto texcoords = convertToFormat<vsg::vec2Array>(data).cast<vsg::vec2Array>();
+        if (!texcoords) return data;
+
+        return transformArray<vsg::usvec2Array>(*texcoords, [](const vsg::vec2& tc) {
+            return vsg::usvec2(floatToHalf(tc.x), floatToHalf(tc.y));
+        });
+    }
+
+    // expand unorm8 colors to the float vectors used when attributes aren't quantized
+    vsg::ref_ptr<vsg::Data> expandColors(const vsg::ref_ptr<vsg::Data>& data)
+    {
+        auto colors = data.cast<vsg::ubvec4Array>();
+        if (!colors) return data;
+
+        return transformArray<vsg::vec4Array>(*colors, [](const vsg::ubvec4& c) {
+            return vsg::vec4(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f);
+        });
+    }
+
+    // hash the layout and contents of the data, mixing in 8 bytes at a time so large arrays hash quickly.
+    // the dynamic type isn't used so arrays adopting osg storage match byte identical copies.
+    uint64_t computeDataHash(const vsg::Data& data)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](uint64_t value) {
+            hash = (hash ^ value) * 1099511628211ull;
+            hash ^= hash >> 32;
+        };
+
+        mix(data.valueSize());
+        mix(data.valueCount());
+        mix(data.properties.format);
+
+        auto bytes = static_cast<const uint8_t*>(data.dataPointer());
+        size_t size = data.dataSize();
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            mix(word);
+        }
+        for (; i < size; ++i) mix(bytes[i]);
+
+        return hash;
+    }
+
+    bool sameData(const vsg::Data& lhs, const vsg::Data& rhs)
+    {
+        return lhs.valueSize() == rhs.valueSize() && lhs.valueCount() == rhs.valueCount() && lhs.properties.format == rhs.properties.format &&
+               lhs.dataSize() == rhs.dataSize() && std::memcmp(lhs.dataPointer(), rhs.dataPointer(), lhs.dataSize()) == 0;
+    }
+
+    vsg::ref_ptr<vsg::Data> DataCache::share(vsg::ref_ptr<vsg::Data> data, bool indices, ConversionStatistics* statistics)
+    {
+        if (!data) return data;
+
+        auto hash = computeDataHash(*data);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto& dataMap = indices ? indicesMap : arrayMap;
+        auto [first, last] = dataMap.equal_range(hash);
+        for (auto itr = first; itr != last; ++itr)
+        {
+            if (itr->second == data) return data;
+            if (sameData(*itr->second, *data))
+            {
+                if (statistics)
+                {
+                    ++statistics->numSharedArrays;
+                    statistics->sharedBytes += data->dataSize();
+                }
+                return itr->second;
+            }
+        }
+
+        dataMap.emplace(hash, data);
+        return data;
+    }
+
+    void DataCache::share(vsg::DataList& arrays, ConversionStatistics* statistics)
+    {
+        for (auto& array : arrays) array = share(array, false, statistics);
+    }
+
+    vsg::ref_ptr<vsg::Command> DataCache::share(CommandKey key, vsg::ref_ptr<vsg::Command> command, ConversionStatistics* statistics)
+    {
+        if (!command) return command;
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto [itr, inserted] = commandMap.emplace(std::move(key), command);
+        if (!inserted && statistics) ++statistics->numSharedGeometries;
+        return itr->second;
+    }
+
+    vsg::ref_ptr<vsg::vec4Array> TangentCache::getOrCreate(const vsg::DataList& sources, const std::function<vsg::ref_ptr<vsg::vec4Array>()>& generate, ConversionStatistics* statistics)
+    {
+        uint64_t hash = 0;
+        for (auto& source : sources) hash = hash * 31 + computeDataHash(*source);
+
+        auto findEntry = [&]() -> vsg::ref_ptr<vsg::vec4Array> {
+            auto [first, last] = entries.equal_range(hash);
+            for (auto itr = first; itr != last; ++itr)
+            {
+                auto& entry = itr->second;
+                bool same = entry.sources.size() == sources.size();
+                for (size_t i = 0; same && i < sources.size(); ++i)
+                {
+                    same = entry.sources[i] == sources[i] || sameData(*entry.sources[i], *sources[i]);
+                }
+                if (same) return entry.tangents;
+            }
+            return {};
+        };
+
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (auto tangents = findEntry())
+            {
+                if (statistics) ++statistics->numCachedTangentArrays;
+                return tangents;
+            }
+        }
+
+        // generate outside the lock so other geometries can be processed in parallel, if another thread added the same entry meanwhile use its result
+        auto tangents = generate();
+        if (statistics) ++statistics->numGeneratedTangentArrays;
+
+        std::lock_guard<std::mutex> guard(mutex);
+        if (auto existing = findEntry()) return existing;
+        entries.emplace(hash, Entry{sources, tangents});
+        return tangents;
+    }
+
+    vsg::ref_ptr<vsg::Data> createTangents(const vsg::ref_ptr<vsg::Data>& vertices, const vsg::ref_ptr<vsg::Data>& normals, const vsg::ref_ptr<vsg::Data>& texcoords, const std::vector<uint32_t>& triangles, const BuildOptions& buildOptions)
+    {
+        auto positions = vertices.cast<vsg::vec3Array>();
+        auto uvs = texcoords.cast<vsg::vec2Array>();
+        if (!positions || !uvs || uvs->size() != positions->size()) return {};
+
+        size_t vertexCount = positions->size();
+        if (*std::max_element(triangles.begin(), triangles.end()) >= vertexCount) return {};
+
+        // normals not bound per vertex are replaced by the triangle normals
+        auto vertexNormals = normals.cast<vsg::vec3Array>();
+        if (vertexNormals && vertexNormals->size() != vertexCount) vertexNormals = {};
+
+        auto generate = [&]() {
+            auto generated = generateTangents(triangles, positions->data(), vertexNormals ? vertexNormals->data() : nullptr, uvs->data(), vertexCount);
+            auto tangents = vsg::vec4Array::create(static_cast<uint32_t>(vertexCount));
+            std::copy(generated.begin(), generated.end(), tangents->begin());
+            return tangents;
+        };
+
+        auto& statistics = buildOptions.statistics;
+        if (!buildOptions.tangentCache)
+        {
+            if (statistics) ++statistics->numGeneratedTangentArrays;
+            return generate();
+        }
+
+        auto indices = vsg::uintArray::create(static_cast<uint32_t>(triangles.size()));
+        std::copy(triangles.begin(), triangles.end(), indices->begin());
+
+        vsg::DataList sources{positions, uvs, indices};
+        if (vertexNormals) sources.push_back(vertexNormals);
+        return buildOptions.tangentCache->getOrCreate(sources, generate, statistics.get());
+    }
+
+    void ConversionStatistics::print(std::ostream& out) const
+    {
+        out << "split " << numSplitGeometries.load() << " geometries into " << numChunks.load() << " chunks, index data " << indexBytes.load() << " bytes, saving " << (uint32IndexBytes.load() - indexBytes.load()) << " bytes over 32 bit indices" << std::endl;
+        out << "vertex data " << vertexBytes.load() << " bytes, saving " << (floatVertexBytes.load() - vertexBytes.load()) << " bytes over float attributes" << std::endl;
+        out << "merged " << numBatchedGeometries.load() << " geometries into " << numBatches.load() << " batches" << std::endl;
+        out << "instanced " << numInstances.load() << " transformed geometries as " << numInstancedGeometries.load() << " instanced geometries" << std::endl;
+        out << "partitioned " << numChunkedGeometries.load() << " geometries into " << numSpatialChunks.load() << " spatial chunks" << std::endl;
+        out << "generated " << numLODLevels.load() << " levels of detail for " << numLODGeometries.load() << " geometries, reducing " << numLODTriangles.load() << " triangles to " << numLODLowestTriangles.load() << " at the lowest level" << std::endl;
+        out << "batched " << numBatchedBillboards.load() << " billboards into " << numBillboardBatches.load() << " spatially clustered billboards" << std::endl;
+        out << "generated " << numGeneratedTangentArrays.load() << " tangent arrays, reused " << numCachedTangentArrays.load() << " cached tangent arrays" << std::endl;
+        if (numTightBounds > 0)
+        {
+            double averageRatio = static_cast<double>(tightRadiusRatioSum.load()) / (static_cast<double>(numTightBounds.load()) * ratioScale);
+            out << "tightened " << numTightBounds.load() << " bounds, reducing their radii by " << (1.0 - averageRatio) * 100.0 << "% on average" << std::endl;
+        }
+        out << "drew " << numIndirectCommands.load() << " draws with " << numIndirectDraws.load() << " indirect draws" << std::endl;
+        if (overdrawPixelsCovered > 0)
+        {
+            double pixelsCovered = static_cast<double>(overdrawPixelsCovered.load());
+            out << "estimated overdraw " << overdrawPixelsShadedBefore.load() / pixelsCovered << " reduced to " << overdrawPixelsShadedAfter.load() / pixelsCovered << " for " << numOverdrawOptimizedGeometries.load() << " geometries" << std::endl;
+        }
+        else if (numOverdrawOptimizedGeometries > 0)
+        {
+            out << "reordered " << numOverdrawOptimizedGeometries.load() << " geometries to reduce overdraw" << std::endl;
+        }
+        if (numVertexCacheIndices > 0)
+        {
+            double numTriangles = static_cast<double>(numVertexCacheIndices.load() / 3);
+            out << "vertex cache ACMR " << vertexCacheMissesBefore.load() / numTriangles << " reduced to " << vertexCacheMissesAfter.load() / numTriangles << ", fetch order optimized for " << numFetchOptimizedGeometries.load() << " geometries, skipped for " << numFetchOptimizationSkippedGeometries.load() << " with arrays that couldn't be reordered" << std::endl;
+        }
+        out << "shared " << numSharedArrays.load() << " identical arrays and " << numSharedGeometries.load() << " identical geometries, saving " << sharedBytes.load() << " bytes" << std::endl;
+    }
+
+    vsg::ref_ptr<vsg::Command> convertToVsg(osg::Geometry* ingeometry, uint32_t requiredAttributesMask, const BuildOptions& buildOptions, bool opaque)
+    {
+        auto geometryTarget = buildOptions.geometryTarget;
+        bool vertexIndexDraw = geometryTarget == VSG_VERTEXINDEXDRAW || geometryTarget == VSG_DRAWINDEXEDINDIRECT; // indirect draws are assembled from VertexIndexDraws
+        bool zeroCopyArrays = buildOptions.zeroCopyArrays;
+
+        uint32_t instanceCount = 1;
+
+        // work out if we need to enable instancing by looking at BIND_OVERALL entries
+        // to see if any have more than one element which we'll interpret as requesting instancing, such as for our custom osg::Billboard handling.
+        {
+            osg::Geometry::ArrayList arrays;
+            if (ingeometry->getArrayList(arrays))
+            {
+                for (auto& array : arrays)
+                {
+                    if (array->getBinding() == osg::Array::BIND_OVERALL)
+                    {
+                        if (instanceCount < array->getNumElements()) instanceCount = array->getNumElements();
+                    }
+                }
+            }
+        }
+
+        // BIND_OVERALL arrays are bound per instance so are padded to the instance count, per vertex arrays keep their own size
+        auto bindOverallPaddingCount = [&](const osg::Array* array) { return (array && array->getBinding() == osg::Array::BIND_OVERALL) ? instanceCount : 0u; };
 
         // convert indices
 
@@ -392,26 +885,242 @@ namespace osg2vsg
         // nothing to draw so return a null ref_ptr<>
         if (triangles.empty()) return {};
 
-        vsg::ref_ptr<vsg::Data> vsgindices;
-        if (vertices->valueCount() > 16384)
+        // convert attribute arrays, create defaults for any requested attributes that don't exist for now to ensure pipeline gets required data
+        vsg::ref_ptr<vsg::Data> vertices(osg2vsg::convertToVsg(ingeometry->getVertexArray(), bindOverallPaddingCount(ingeometry->getVertexArray()), zeroCopyArrays));
+        if (!vertices.valid() || vertices->valueCount() == 0) return {};
+
+        // normals
+        vsg::ref_ptr<vsg::Data> normals(osg2vsg::convertToVsg(ingeometry->getNormalArray(), bindOverallPaddingCount(ingeometry->getNormalArray()), zeroCopyArrays));
+
+        // tex0
+        vsg::ref_ptr<vsg::Data> texcoord0(osg2vsg::convertToVsg(ingeometry->getTexCoordArray(0), bindOverallPaddingCount(ingeometry->getTexCoordArray(0)), zeroCopyArrays));
+
+        // tangents
+        vsg::ref_ptr<vsg::Data> tangents(osg2vsg::convertToVsg(ingeometry->getVertexAttribArray(6), bindOverallPaddingCount(ingeometry->getVertexAttribArray(6)), zeroCopyArrays));
+
+        // colors
+        vsg::ref_ptr<vsg::Data> colors(osg2vsg::convertToVsg(ingeometry->getColorArray(), bindOverallPaddingCount(ingeometry->getColorArray()), zeroCopyArrays));
+
+        vsg::ref_ptr<vsg::Data> translations(osg2vsg::convertToVsg(ingeometry->getVertexAttribArray(7), bindOverallPaddingCount(ingeometry->getVertexAttribArray(7)), zeroCopyArrays));
+
+        vsg::ref_ptr<vsg::Data> instanceMatrices(osg2vsg::convertToVsg(ingeometry->getVertexAttribArray(8), bindOverallPaddingCount(ingeometry->getVertexAttribArray(8)), zeroCopyArrays));
+
+        // the vertex input formats of the pipeline are fixed for each attribute, so arrays of other types, such as vec3 texcoords or double normals,
+        // are converted to match rather than shifting the attributes that follow them in an interleaved array or being misread from their own
+        vertices = convertToFormat<vsg::vec3Array>(vertices);
+        if (!vertices) return {};
+        normals = convertToFormat<vsg::vec3Array>(normals);
+        tangents = convertToFormat<vsg::vec4Array>(tangents);
+        if (!colors.cast<vsg::ubvec4Array>()) colors = convertToFormat<vsg::vec4Array>(colors);
+        texcoord0 = convertToFormat<vsg::vec2Array>(texcoord0);
+        translations = convertToFormat<vsg::vec3Array>(translations);
+
+        // generate tangents from the converted arrays when required but not provided, leaving the osg geometry untouched
+        if ((!tangents.valid() || tangents->valueCount() == 0) && (requiredAttributesMask & TANGENT))
+        {
+            tangents = createTangents(vertices, normals, texcoord0, triangles, buildOptions);
+
+            // the pipeline still expects a tangent binding when there aren't the positions and texcoords to generate them from, so fall back to a constant tangent
+            if (!tangents) tangents = vsg::vec4Array::create(vertices->valueCount(), vsg::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+        }
+
+        auto& statistics = buildOptions.statistics;
+        auto& dataCache = buildOptions.dataCache;
+        size_t floatVertexBytes = 0;
+        if (statistics)
         {
-            auto indices = vsg::uintArray::create(triangles.size());
-            for (size_t i = 0; i < triangles.size(); ++i)
+            for (auto& array : {vertices, normals, tangents, colors, texcoord0, translations, instanceMatrices})
             {
-                indices->set(i, triangles[i]);
+                if (array) floatVertexBytes += array->valueCount() * (array.cast<vsg::ubvec4Array>() ? sizeof(vsg::vec4) : array->valueSize());
             }
-            vsgindices = indices;
+        }
+
+        if (requiredAttributesMask & QUANTIZED)
+        {
+            normals = quantizeNormals(normals);
+            tangents = quantizeTangents(tangents);
+            colors = quantizeColors(colors);
+            texcoord0 = quantizeTexCoords(texcoord0);
         }
         else
         {
-            auto indices = vsg::ushortArray::create(triangles.size());
-            for (size_t i = 0; i < triangles.size(); ++i)
+            colors = expandColors(colors);
+        }
+
+        // fill arrays data list THE ORDER HERE IS IMPORTANT, along with whether each array is bound per vertex or, for BIND_OVERALL, per instance
+        auto attributeArrays = vsg::DataList{vertices}; // always have vertices
+        std::vector<bool> perVertex{true};
+        auto addArray = [&](const vsg::ref_ptr<vsg::Data>& array, uint32_t overallMask) {
+            if (!array.valid() || array->valueCount() == 0) return;
+            attributeArrays.push_back(array);
+            perVertex.push_back((requiredAttributesMask & overallMask) == 0);
+        };
+        addArray(normals, NORMAL_OVERALL);
+        addArray(tangents, TANGENT_OVERALL);
+        addArray(colors, COLOR_OVERALL);
+        addArray(texcoord0, 0);
+        addArray(translations, TRANSLATE_OVERALL);
+        if (requiredAttributesMask & INSTANCE_MATRIX) addArray(instanceMatrices, INSTANCE_MATRIX);
+
+        if (statistics)
+        {
+            for (auto& array : attributeArrays) statistics->vertexBytes += array->dataSize();
+            statistics->floatVertexBytes += floatVertexBytes;
+        }
+
+        bool interleaved = (requiredAttributesMask & INTERLEAVED) != 0;
+
+        // reorder the triangles for the post transform vertex cache, then renumber the vertices in the order they are first used so fetches walk the arrays sequentially.
+        // the reordered arrays are new copies so the osg arrays, or vsg arrays sharing their storage, are left untouched.
+        uint32_t vertexCount = vertices->valueCount();
+        bool validIndices = *std::max_element(triangles.begin(), triangles.end()) < vertexCount;
+        if (buildOptions.optimizeVertexCache && validIndices)
+        {
+            if (statistics) statistics->vertexCacheMissesBefore += countVertexCacheMisses(triangles, vertexCount);
+
+            triangles = optimizeVertexCache(triangles, vertexCount);
+        }
+
+        // draw the clusters of opaque meshes most likely to occlude the rest first, when asked for the estimated overdraw is compared with the vertex cache order
+        auto positions = vertices.cast<vsg::vec3Array>();
+        if (opaque && buildOptions.optimizeOverdraw && positions && validIndices)
+        {
+            bool analyze = statistics && buildOptions.analyzeOverdraw;
+            auto overdrawBefore = analyze ? analyzeOverdraw(triangles, positions->data(), vertexCount) : OverdrawStatistics{};
+
+            triangles = optimizeOverdraw(triangles, positions->data(), vertexCount, buildOptions.overdrawThreshold);
+
+            if (statistics) statistics->numOverdrawOptimizedGeometries++;
+            if (analyze)
+            {
+                auto overdrawAfter = analyzeOverdraw(triangles, positions->data(), vertexCount);
+                statistics->overdrawPixelsCovered += overdrawAfter.pixelsCovered;
+                statistics->overdrawPixelsShadedBefore += overdrawBefore.pixelsShaded;
+                statistics->overdrawPixelsShadedAfter += overdrawAfter.pixelsShaded;
+            }
+        }
+
+        if (buildOptions.optimizeVertexCache && validIndices)
+        {
+            auto fetchOrderTriangles = triangles;
+            auto fetchOrder = optimizeVertexFetch(fetchOrderTriangles, vertexCount);
+
+            vsg::DataList reorderedArrays;
+            for (size_t i = 0; i < attributeArrays.size(); ++i)
+            {
+                auto array = perVertex[i] ? gatherVertices(attributeArrays[i], fetchOrder) : attributeArrays[i];
+                if (!array) break;
+                reorderedArrays.push_back(array);
+            }
+
+            // only use the new order when every per vertex array could be reordered
+            if (reorderedArrays.size() == attributeArrays.size())
+            {
+                attributeArrays = reorderedArrays;
+                vertices = attributeArrays[0];
+                triangles.swap(fetchOrderTriangles);
+                if (statistics) statistics->numFetchOptimizedGeometries++;
+            }
+            else if (statistics)
+            {
+                statistics->numFetchOptimizationSkippedGeometries++;
+            }
+
+            if (statistics)
+            {
+                statistics->vertexCacheMissesAfter += countVertexCacheMisses(triangles, vertices->valueCount());
+                statistics->numVertexCacheIndices += triangles.size();
+            }
+        }
+
+        // split meshes with too many vertices for 16 bit indices into chunks that each have their own vertex arrays and 16 bit or smaller indices.
+        // arrays bound per instance are shared by all the chunks so splitting is only possible when they aren't used for instancing.
+        if (buildOptions.splitLargeGeometries && vertexIndexDraw && drawCommands.empty() && instanceCount == 1 && vertices->valueCount() > maxUShortIndexedVertices)
+        {
+            auto chunks = splitTriangles(triangles, vertices->valueCount(), maxUShortIndexedVertices);
+
+            auto commands = vsg::Commands::create();
+            size_t chunkIndexBytes = 0;
+            std::vector<const vsg::Object*> keyObjects;
+            for (auto& chunk : chunks)
             {
-                indices->set(i, triangles[i]);
+                vsg::DataList chunkArrays;
+                for (size_t i = 0; i < attributeArrays.size(); ++i)
+                {
+                    // per vertex arrays are gathered for the chunk, BIND_OVERALL arrays are shared
+                    auto chunkArray = perVertex[i] ? gatherVertices(attributeArrays[i], chunk.vertices) : attributeArrays[i];
+                    if (!chunkArray) break;
+                    chunkArrays.push_back(chunkArray);
+                }
+                if (chunkArrays.size() != attributeArrays.size()) break;
+                if (interleaved) chunkArrays = interleaveArrays(chunkArrays, perVertex);
+
+                auto chunkIndices = createIndices(chunk.indices, chunk.vertices.size(), buildOptions.uint8Indices);
+                chunkIndexBytes += chunkIndices->dataSize();
+
+                if (dataCache)
+                {
+                    dataCache->share(chunkArrays, statistics.get());
+                    chunkIndices = dataCache->share(chunkIndices, true, statistics.get());
+
+                    // null separates the chunks in the key
+                    keyObjects.insert(keyObjects.end(), chunkArrays.begin(), chunkArrays.end());
+                    keyObjects.push_back(chunkIndices.get());
+                    keyObjects.push_back(nullptr);
+                }
+
+                auto vid = vsg::VertexIndexDraw::create();
+                vid->assignArrays(chunkArrays);
+                vid->assignIndices(chunkIndices);
+                vid->indexCount = chunkIndices->valueCount();
+                vid->instanceCount = instanceCount;
+                vid->firstIndex = 0;
+                vid->vertexOffset = 0;
+                vid->firstInstance = 0;
+                commands->addChild(vid);
             }
-            vsgindices = indices;
+
+            // only use the chunks if every attribute array could be gathered, otherwise fall back to a single draw with 32 bit indices
+            if (commands->children.size() == chunks.size())
+            {
+                if (statistics)
+                {
+                    ++statistics->numSplitGeometries;
+                    statistics->numChunks += chunks.size();
+                    statistics->indexBytes += chunkIndexBytes;
+                    statistics->uint32IndexBytes += triangles.size() * sizeof(uint32_t);
+                }
+
+                if (dataCache) return dataCache->share(DataCache::CommandKey{geometryTarget, instanceCount, keyObjects}, commands, statistics.get());
+                return commands;
+            }
+        }
+
+        vsg::ref_ptr<vsg::Data> vsgindices = createIndices(triangles, vertices->valueCount(), buildOptions.uint8Indices);
+
+        if (statistics)
+        {
+            statistics->indexBytes += vsgindices->dataSize();
+            statistics->uint32IndexBytes += triangles.size() * sizeof(uint32_t);
+        }
+
+        if (interleaved) attributeArrays = interleaveArrays(attributeArrays, perVertex);
+
+        if (dataCache)
+        {
+            dataCache->share(attributeArrays, statistics.get());
+            vsgindices = dataCache->share(vsgindices, true, statistics.get());
         }
 
+        // share the draw command with any earlier geometry that converted to the same arrays and indices
+        auto shareCommand = [&](vsg::ref_ptr<vsg::Command> command) -> vsg::ref_ptr<vsg::Command> {
+            if (!dataCache) return command;
+
+            std::vector<const vsg::Object*> keyObjects(attributeArrays.begin(), attributeArrays.end());
+            keyObjects.push_back(vsgindices.get());
+            return dataCache->share(DataCache::CommandKey{geometryTarget, instanceCount, keyObjects}, command, statistics.get());
+        };
+
         if (geometryTarget == VSG_COMMANDS)
         {
             vsg::ref_ptr<vsg::Commands> commands(new vsg::Commands);
@@ -429,9 +1138,9 @@ namespace osg2vsg
                 commands->addChild(vsg::DrawIndexed::create(vsgindices->valueCount(), instanceCount, 0, 0, 0));
             }
 
-            return commands;
+            return shareCommand(commands);
         }
-        else if (geometryTarget == VSG_VERTEXINDEXDRAW && vsgindices && drawCommands.empty())
+        else if (vertexIndexDraw && vsgindices && drawCommands.empty())
         {
             vsg::ref_ptr<vsg::VertexIndexDraw> vid(new vsg::VertexIndexDraw());
 
@@ -443,7 +1152,7 @@ namespace osg2vsg
             vid->vertexOffset = 0;
             vid->firstInstance = 0;
 
-            return vid;
+            return shareCommand(vid);
         }
 
         // fallback to create the vsg geometry
@@ -461,7 +1170,502 @@ namespace osg2vsg
 
         geometry->commands = drawCommands;
 
-        return geometry;
+        return shareCommand(geometry);
+    }
+
+    bool appendIndices(const vsg::Data& indices, std::vector<uint32_t>& allIndices)
+    {
+        if (auto ubytes = dynamic_cast<const vsg::ubyteArray*>(&indices)) allIndices.insert(allIndices.end(), ubytes->begin(), ubytes->end());
+        else if (auto ushorts = dynamic_cast<const vsg::ushortArray*>(&indices)) allIndices.insert(allIndices.end(), ushorts->begin(), ushorts->end());
+        else if (auto uints = dynamic_cast<const vsg::uintArray*>(&indices)) allIndices.insert(allIndices.end(), uints->begin(), uints->end());
+        else return false;
+        return true;
+    }
+
+    vsg::ref_ptr<vsg::Node> createLODs(vsg::ref_ptr<vsg::Command> command, const BuildOptions& buildOptions)
+    {
+        if (!buildOptions.generateLODs || buildOptions.numLODLevels == 0) return command;
+
+        // instanced draws are excluded as the bounds of their vertices aren't the bounds of what is drawn
+        auto vid = command.cast<vsg::VertexIndexDraw>();
+        if (!vid || !vid->indices || !vid->indices->data || vid->arrays.empty() || vid->instanceCount != 1 || vid->firstIndex != 0 || vid->vertexOffset != 0) return command;
+
+        auto positions = vid->arrays[0]->data.cast<vsg::vec3Array>();
+        if (!positions || positions->size() == 0 || vid->indexCount / 3 <= buildOptions.lodTriangleThreshold) return command;
+
+        std::vector<uint32_t> indices;
+        if (!appendIndices(*vid->indices->data, indices)) return command;
+        indices.resize(std::min(indices.size(), static_cast<size_t>(vid->indexCount)));
+        if (*std::max_element(indices.begin(), indices.end()) >= positions->size()) return command;
+
+        size_t numTriangles = indices.size() / 3;
+        size_t vertexCount = positions->size();
+
+        // simplify each level from the previous one, stopping early once the simplifier can no longer make a worthwhile reduction
+        std::vector<size_t> levelSizes{indices.size()};
+        MeshSimplifier simplifier(indices, positions->data(), vertexCount);
+        double targetRatio = 1.0;
+        for (uint32_t level = 1; level <= buildOptions.numLODLevels; ++level)
+        {
+            targetRatio *= buildOptions.lodReduction;
+            size_t targetTriangles = static_cast<size_t>(static_cast<double>(numTriangles) * targetRatio);
+            size_t numRemaining = simplifier.simplify(targetTriangles);
+            size_t previousTriangles = levelSizes.back() / 3;
+            if (numRemaining == 0 || numRemaining * 4 > previousTriangles * 3) break; // less than a quarter fewer triangles than the previous level
+
+            auto levelIndices = simplifier.indices();
+            if (buildOptions.optimizeVertexCache) levelIndices = optimizeVertexCache(levelIndices, vertexCount);
+            indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+            levelSizes.push_back(levelIndices.size());
+        }
+        if (levelSizes.size() == 1) return command;
+
+        auto lodIndices = createIndices(indices, vertexCount, buildOptions.uint8Indices);
+
+        vsg::vec3 bb_min = positions->at(0);
+        vsg::vec3 bb_max = bb_min;
+        for (auto& p : *positions)
+        {
+            bb_min.set(std::min(bb_min.x, p.x), std::min(bb_min.y, p.y), std::min(bb_min.z, p.z));
+            bb_max.set(std::max(bb_max.x, p.x), std::max(bb_max.y, p.y), std::max(bb_max.z, p.z));
+        }
+        vsg::dvec3 center = (vsg::dvec3(bb_min) + vsg::dvec3(bb_max)) * 0.5;
+
+        auto lod = vsg::LOD::create();
+        lod->bound.set(center.x, center.y, center.z, vsg::length(vsg::dvec3(bb_max) - vsg::dvec3(bb_min)) * 0.5);
+        if (buildOptions.tightBounds) lod->bound = computeTightBound(*vid, lod->bound, buildOptions.statistics.get());
+
+        // each level reduces the triangles by lodReduction so switching when the screen height has reduced by its square root keeps the triangle density on screen similar
+        double minimumScreenHeightRatio = buildOptions.lodScreenRatio;
+        double screenRatioScale = std::sqrt(static_cast<double>(buildOptions.lodReduction));
+        vsg::ref_ptr<vsg::BufferInfo> indexBufferInfo;
+        uint32_t firstIndex = 0;
+        for (size_t level = 0; level < levelSizes.size(); ++level)
+        {
+            auto levelDraw = vsg::VertexIndexDraw::create();
+            levelDraw->firstBinding = vid->firstBinding;
+            levelDraw->arrays = vid->arrays;
+            levelDraw->assignIndices(lodIndices);
+            if (indexBufferInfo)
+                levelDraw->indices = indexBufferInfo;
+            else
+                indexBufferInfo = levelDraw->indices;
+            levelDraw->indexCount = static_cast<uint32_t>(levelSizes[level]);
+            levelDraw->firstIndex = firstIndex;
+            levelDraw->instanceCount = 1;
+
+            // the lowest level is drawn however small the geometry is on screen
+            bool lowestLevel = (level + 1) == levelSizes.size();
+            lod->addChild(vsg::LOD::Child{lowestLevel ? 0.0 : minimumScreenHeightRatio, levelDraw});
+
+            firstIndex += levelDraw->indexCount;
+            minimumScreenHeightRatio *= screenRatioScale;
+        }
+
+        if (auto& statistics = buildOptions.statistics)
+        {
+            statistics->numLODGeometries++;
+            statistics->numLODLevels += levelSizes.size() - 1;
+            statistics->numLODTriangles += numTriangles;
+            statistics->numLODLowestTriangles += levelSizes.back() / 3;
+        }
+
+        return lod;
+    }
+
+    vsg::ref_ptr<vsg::Command> createDrawIndexedIndirect(const std::vector<vsg::ref_ptr<vsg::Command>>& leaves, ConversionStatistics* statistics)
+    {
+        auto commands = vsg::Commands::create();
+
+        std::vector<vsg::VertexIndexDraw*> draws;
+        auto addLeaf = [&](vsg::Command* leaf) {
+            auto vid = dynamic_cast<vsg::VertexIndexDraw*>(leaf);
+            if (vid && vid->indices && vid->instanceCount == 1 && vid->firstIndex == 0 && vid->vertexOffset == 0 && vid->firstInstance == 0 && !vid->arrays.empty())
+                draws.push_back(vid);
+            else
+                commands->addChild(vsg::ref_ptr<vsg::Command>(leaf));
+        };
+
+        for (auto& leaf : leaves)
+        {
+            if (auto leafCommands = leaf.cast<vsg::Commands>())
+            {
+                for (auto& child : leafCommands->children) addLeaf(child);
+            }
+            else
+            {
+                addLeaf(leaf);
+            }
+        }
+
+        // arrays with an element per vertex are concatenated and addressed by vertexOffset, BIND_OVERALL arrays have a single element
+        // and are addressed by firstInstance, so each array slot must have the same type and rate in every draw
+        vsg::BufferInfoList firstArrays;
+        if (!draws.empty()) firstArrays = draws.front()->arrays;
+
+        // the bytes per vertex of a per vertex array, or 0 for a per instance array. The ubyte array packed by interleaveArrays() holds several attributes per vertex
+        // so is matched by its byte stride rather than its element count.
+        auto vertexStride = [](const vsg::Data& data, size_t vertexCount) -> size_t {
+            if (data.valueCount() == vertexCount) return data.valueSize();
+            if (dynamic_cast<const vsg::ubyteArray*>(&data) && vertexCount > 0 && data.valueCount() > vertexCount && data.dataSize() % vertexCount == 0) return data.dataSize() / vertexCount;
+            return 0;
+        };
+
+        std::vector<size_t> strides;
+        bool perInstanceArrays = false;
+        for (auto& bufferInfo : firstArrays)
+        {
+            strides.push_back(vertexStride(*bufferInfo->data, firstArrays[0]->data->valueCount()));
+            if (strides.back() == 0) perInstanceArrays = true;
+        }
+
+        std::vector<vsg::VertexIndexDraw*> compatibleDraws;
+        std::vector<uint32_t> firstIndices;
+        std::vector<uint32_t> allIndices;
+        for (auto vid : draws)
+        {
+            bool compatible = vid->arrays.size() == firstArrays.size();
+            size_t vertexCount = vid->arrays[0]->data->valueCount();
+            for (size_t i = 0; compatible && i < firstArrays.size(); ++i)
+            {
+                auto& data = *vid->arrays[i]->data;
+                bool perVertex = strides[i] > 0;
+                compatible = data.valueSize() == firstArrays[i]->data->valueSize() && data.properties.format == firstArrays[i]->data->properties.format &&
+                             (perVertex ? vertexStride(data, vertexCount) == strides[i] : data.valueCount() == 1) && (i == 0 || perVertex || vertexCount != 1);
+            }
+
+            size_t firstIndex = allIndices.size();
+            if (compatible && appendIndices(*vid->indices->data, allIndices))
+            {
+                compatibleDraws.push_back(vid);
+                firstIndices.push_back(static_cast<uint32_t>(firstIndex));
+            }
+            else
+            {
+                allIndices.resize(firstIndex);
+                commands->addChild(vsg::ref_ptr<vsg::Command>(vid));
+            }
+        }
+
+        if (compatibleDraws.size() == 1) commands->addChild(vsg::ref_ptr<vsg::Command>(compatibleDraws.front()));
+
+        if (compatibleDraws.size() > 1)
+        {
+            size_t maxVertexCount = 0;
+            auto drawCommands = vsg::uintArray::create(static_cast<uint32_t>(compatibleDraws.size() * 5));
+            auto drawCommand = drawCommands->data();
+
+            uint32_t vertexOffset = 0;
+            for (uint32_t d = 0; d < compatibleDraws.size(); ++d)
+            {
+                auto vid = compatibleDraws[d];
+
+                // VkDrawIndexedIndirectCommand members in order
+                *drawCommand++ = vid->indexCount;
+                *drawCommand++ = 1;
+                *drawCommand++ = firstIndices[d];
+                *drawCommand++ = vertexOffset;
+                *drawCommand++ = perInstanceArrays ? d : 0; // a non zero firstInstance requires the drawIndirectFirstInstance device feature
+
+                size_t vertexCount = vid->arrays[0]->data->valueCount();
+                maxVertexCount = std::max(maxVertexCount, vertexCount);
+                vertexOffset += static_cast<uint32_t>(vertexCount);
+            }
+
+            vsg::DataList arrays;
+            for (size_t i = 0; i < firstArrays.size(); ++i)
+            {
+                size_t totalSize = 0;
+                for (auto vid : compatibleDraws) totalSize += vid->arrays[i]->data->dataSize();
+
+                // the vertices keep their type so bounds can still be computed from them, the other arrays only need their bytes
+                vsg::ref_ptr<vsg::Data> array;
+                if (firstArrays[i]->data.cast<vsg::vec3Array>())
+                    array = vsg::vec3Array::create(static_cast<uint32_t>(totalSize / sizeof(vsg::vec3)));
+                else
+                    array = vsg::ubyteArray::create(static_cast<uint32_t>(totalSize));
+
+                auto dest = static_cast<uint8_t*>(array->dataPointer());
+                for (auto vid : compatibleDraws)
+                {
+                    auto& data = *vid->arrays[i]->data;
+                    std::memcpy(dest, data.dataPointer(), data.dataSize());
+                    dest += data.dataSize();
+                }
+                arrays.push_back(array);
+            }
+
+            // indices are relative to each draw's vertexOffset so only need to address the largest draw
+            auto indices = createIndices(allIndices, maxVertexCount, false);
+
+            commands->addChild(vsg::BindVertexBuffers::create(0, arrays));
+            commands->addChild(vsg::BindIndexBuffer::create(indices));
+            commands->addChild(vsg::DrawIndexedIndirect::create(drawCommands, static_cast<uint32_t>(compatibleDraws.size()), static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand))));
+
+            if (statistics)
+            {
+                ++statistics->numIndirectDraws;
+                statistics->numIndirectCommands += compatibleDraws.size();
+            }
+        }
+
+        if (commands->children.empty()) return {};
+        if (commands->children.size() == 1) return commands->children.front();
+        return commands;
+    }
+
+    struct CollectTriangles
+    {
+        std::vector<uint32_t>* indices = nullptr;
+        uint32_t baseVertex = 0;
+
+        void operator()(unsigned int i0, unsigned int i1, unsigned int i2)
+        {
+            indices->push_back(baseVertex + i0);
+            indices->push_back(baseVertex + i1);
+            indices->push_back(baseVertex + i2);
+        }
+    };
+
+    // create an empty array of the same type, binding and normalization as array, sized to numElements
+    osg::ref_ptr<osg::Array> createArrayOfSameType(const osg::Array& array, unsigned int numElements)
+    {
+        osg::ref_ptr<osg::Array> newArray = static_cast<osg::Array*>(array.cloneType());
+        newArray->setBinding(array.getBinding());
+        newArray->setNormalize(array.getNormalize());
+        newArray->resizeArray(numElements);
+        return newArray;
+    }
+
+    // the array owns its storage so writing through the data pointer is safe
+    uint8_t* writableDataPointer(osg::Array& array)
+    {
+        return static_cast<uint8_t*>(const_cast<GLvoid*>(array.getDataPointer()));
+    }
+
+    osg::ref_ptr<osg::Geometry> mergeGeometries(const std::vector<osg::Geometry*>& geometries)
+    {
+        auto& first = *geometries.front();
+
+        osg::ref_ptr<osg::Geometry> merged = new osg::Geometry;
+        merged->setStateSet(first.getStateSet());
+
+        // concatenate the elements of each geometry's array into a new array of the same type
+        auto mergeArrays = [&geometries](auto getArray) -> osg::ref_ptr<osg::Array> {
+            const osg::Array* firstArray = getArray(*geometries.front());
+            if (!firstArray) return {};
+
+            unsigned int numElements = 0;
+            for (auto geometry : geometries) numElements += getArray(*geometry)->getNumElements();
+
+            auto array = createArrayOfSameType(*firstArray, numElements);
+            auto dest = writableDataPointer(*array);
+            for (auto geometry : geometries)
+            {
+                const osg::Array* source = getArray(*geometry);
+                std::memcpy(dest, source->getDataPointer(), source->getTotalDataSize());
+                dest += source->getTotalDataSize();
+            }
+            return array;
+        };
+
+        merged->setVertexArray(mergeArrays([](osg::Geometry& geometry) { return geometry.getVertexArray(); }).get());
+        merged->setNormalArray(mergeArrays([](osg::Geometry& geometry) { return geometry.getNormalArray(); }).get(), osg::Array::BIND_PER_VERTEX);
+        merged->setColorArray(mergeArrays([](osg::Geometry& geometry) { return geometry.getColorArray(); }).get(), osg::Array::BIND_PER_VERTEX);
+        merged->setTexCoordArray(0, mergeArrays([](osg::Geometry& geometry) { return geometry.getTexCoordArray(0); }).get(), osg::Array::BIND_PER_VERTEX);
+        merged->setVertexAttribArray(6, mergeArrays([](osg::Geometry& geometry) { return geometry.getVertexAttribArray(6); }).get(), osg::Array::BIND_PER_VERTEX);
+
+        // only triangles are converted so strips, fans and quads are decomposed to triangles, offset to their geometry's vertices in the merged arrays
+        std::vector<uint32_t> indices;
+        osg::TriangleIndexFunctor<CollectTriangles> collectTriangles;
+        collectTriangles.indices = &indices;
+        for (auto geometry : geometries)
+        {
+            geometry->accept(collectTriangles);
+            collectTriangles.baseVertex += geometry->getVertexArray()->getNumElements();
+        }
+
+        if (!indices.empty())
+        {
+            merged->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, indices.begin(), indices.end()));
+        }
+
+        return merged;
+    }
+
+    // copy the listed elements of array into a new array of the same type
+    osg::ref_ptr<osg::Array> gatherArray(const osg::Array* array, const std::vector<uint32_t>& elements)
+    {
+        if (!array) return {};
+
+        auto newArray = createArrayOfSameType(*array, static_cast<unsigned int>(elements.size()));
+        auto dest = writableDataPointer(*newArray);
+        auto source = static_cast<const uint8_t*>(array->getDataPointer());
+        size_t elementSize = array->getElementSize();
+        for (auto element : elements)
+        {
+            std::memcpy(dest, source + element * elementSize, elementSize);
+            dest += elementSize;
+        }
+        return newArray;
+    }
+
+    // create a geometry with just the listed triangles and the vertices they reference, sharing the StateSet of geometry
+    osg::ref_ptr<osg::Geometry> extractTriangles(const osg::Geometry& geometry, const std::vector<uint32_t>& triangleIndices, const uint32_t* triangles, size_t numTriangles)
+    {
+        const uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> newIndex(geometry.getVertexArray()->getNumElements(), unassigned);
+        std::vector<uint32_t> vertices;
+        std::vector<uint32_t> indices;
+        indices.reserve(numTriangles * 3);
+
+        for (size_t t = 0; t < numTriangles; ++t)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                uint32_t index = triangleIndices[triangles[t] * 3 + i];
+                if (newIndex[index] == unassigned)
+                {
+                    newIndex[index] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(index);
+                }
+                indices.push_back(newIndex[index]);
+            }
+        }
+
+        // single element BIND_OVERALL arrays are shared by every chunk unchanged, as splitTriangles() does, per vertex arrays are gathered
+        auto chunkArray = [&](const osg::Array* array) -> osg::ref_ptr<osg::Array> {
+            if (array && array->getBinding() == osg::Array::BIND_OVERALL) return const_cast<osg::Array*>(array);
+            return gatherArray(array, vertices);
+        };
+        auto binding = [](const osg::Array* array) {
+            return (array && array->getBinding() == osg::Array::BIND_OVERALL) ? osg::Array::BIND_OVERALL : osg::Array::BIND_PER_VERTEX;
+        };
+
+        osg::ref_ptr<osg::Geometry> chunk = new osg::Geometry;
+        chunk->setStateSet(const_cast<osg::StateSet*>(geometry.getStateSet()));
+        chunk->setVertexArray(gatherArray(geometry.getVertexArray(), vertices).get());
+        chunk->setNormalArray(chunkArray(geometry.getNormalArray()).get(), binding(geometry.getNormalArray()));
+        chunk->setColorArray(chunkArray(geometry.getColorArray()).get(), binding(geometry.getColorArray()));
+        chunk->setSecondaryColorArray(chunkArray(geometry.getSecondaryColorArray()).get(), binding(geometry.getSecondaryColorArray()));
+        chunk->setFogCoordArray(chunkArray(geometry.getFogCoordArray()).get(), binding(geometry.getFogCoordArray()));
+        for (unsigned int unit = 0; unit < geometry.getNumTexCoordArrays(); ++unit)
+        {
+            chunk->setTexCoordArray(unit, chunkArray(geometry.getTexCoordArray(unit)).get(), binding(geometry.getTexCoordArray(unit)));
+        }
+        for (unsigned int index = 0; index < geometry.getNumVertexAttribArrays(); ++index)
+        {
+            chunk->setVertexAttribArray(index, chunkArray(geometry.getVertexAttribArray(index)).get(), binding(geometry.getVertexAttribArray(index)));
+        }
+        chunk->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, indices.begin(), indices.end()));
+
+        return chunk;
+    }
+
+    // builds the SpatialChunks tree by recursively splitting the triangles at the median centroid along the longest axis
+    struct SpatialPartitioner
+    {
+        const osg::Geometry& geometry;
+        uint32_t maxTriangles;
+        double maxExtent;
+
+        std::vector<osg::Vec3d> positions;
+        std::vector<uint32_t> triangleIndices;
+        std::vector<osg::Vec3d> centroids;
+        std::vector<uint32_t> triangles;
+        SpatialChunks chunks;
+
+        bool withinLimits(size_t numTriangles, const osg::BoundingBoxd& bb) const
+        {
+            double extent = std::max({bb.xMax() - bb.xMin(), bb.yMax() - bb.yMin(), bb.zMax() - bb.zMin()});
+            return numTriangles <= maxTriangles && (maxExtent <= 0.0 || extent <= maxExtent);
+        }
+
+        size_t partition(size_t begin, size_t end)
+        {
+            osg::BoundingBoxd bb;
+            osg::BoundingBoxd centroidBB;
+            for (size_t t = begin; t < end; ++t)
+            {
+                for (size_t i = 0; i < 3; ++i) bb.expandBy(positions[triangleIndices[triangles[t] * 3 + i]]);
+                centroidBB.expandBy(centroids[triangles[t]]);
+            }
+
+            size_t nodeIndex = chunks.nodes.size();
+            chunks.nodes.emplace_back();
+            chunks.nodes[nodeIndex].bound = bb;
+
+            size_t numTriangles = end - begin;
+            osg::Vec3d centroidExtent = centroidBB._max - centroidBB._min;
+            int axis = (centroidExtent.x() >= centroidExtent.y() && centroidExtent.x() >= centroidExtent.z()) ? 0 : (centroidExtent.y() >= centroidExtent.z() ? 1 : 2);
+
+            // coincident centroids can't be separated so leave them in one chunk
+            if (withinLimits(numTriangles, bb) || numTriangles < 2 || centroidExtent[axis] <= 0.0)
+            {
+                chunks.nodes[nodeIndex].geometry = extractTriangles(geometry, triangleIndices, triangles.data() + begin, numTriangles);
+                return nodeIndex;
+            }
+
+            size_t middle = begin + numTriangles / 2;
+            std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+                             [&](uint32_t lhs, uint32_t rhs) { return centroids[lhs][axis] < centroids[rhs][axis]; });
+
+            size_t left = partition(begin, middle);
+            size_t right = partition(middle, end);
+            chunks.nodes[nodeIndex].children = {left, right};
+            return nodeIndex;
+        }
+    };
+
+    SpatialChunks partitionGeometry(const osg::Geometry& geometry, uint32_t maxTriangles, double maxExtent)
+    {
+        SpatialPartitioner partitioner{geometry, std::max(maxTriangles, 1u), maxExtent, {}, {}, {}, {}, {}};
+
+        auto vertices = geometry.getVertexArray();
+        if (auto vec3s = dynamic_cast<const osg::Vec3Array*>(vertices))
+            partitioner.positions.assign(vec3s->begin(), vec3s->end());
+        else if (auto dvec3s = dynamic_cast<const osg::Vec3dArray*>(vertices))
+            partitioner.positions.assign(dvec3s->begin(), dvec3s->end());
+        else
+            return {};
+
+        // BIND_OVERALL arrays of more than one element are used for instancing, where the bounds of the vertices aren't the bounds of what is drawn.
+        // single element BIND_OVERALL arrays, such as an overall color or normal, are carried through to every chunk.
+        osg::Geometry::ArrayList arrays;
+        const_cast<osg::Geometry&>(geometry).getArrayList(arrays);
+        for (auto& array : arrays)
+        {
+            if (array->getBinding() == osg::Array::BIND_OVERALL)
+            {
+                if (array->getNumElements() > 1) return {};
+            }
+            else if (array->getBinding() != osg::Array::BIND_PER_VERTEX || array->getNumElements() != partitioner.positions.size())
+            {
+                return {};
+            }
+        }
+
+        osg::TriangleIndexFunctor<CollectTriangles> collectTriangles;
+        collectTriangles.indices = &partitioner.triangleIndices;
+        const_cast<osg::Geometry&>(geometry).accept(collectTriangles);
+
+        size_t numTriangles = partitioner.triangleIndices.size() / 3;
+        if (numTriangles <= partitioner.maxTriangles && maxExtent <= 0.0) return {};
+
+        auto& positions = partitioner.positions;
+        for (size_t t = 0; t < numTriangles; ++t)
+        {
+            auto index = &partitioner.triangleIndices[t * 3];
+            partitioner.centroids.push_back((positions[index[0]] + positions[index[1]] + positions[index[2]]) / 3.0);
+            partitioner.triangles.push_back(static_cast<uint32_t>(t));
+        }
+
+        osg::BoundingBoxd bb;
+        for (auto& position : positions) bb.expandBy(position);
+        if (numTriangles == 0 || partitioner.withinLimits(numTriangles, bb)) return {};
+
+        partitioner.partition(0, numTriangles);
+        return std::move(partitioner.chunks);
     }
 
 } // namespace osg2vsg
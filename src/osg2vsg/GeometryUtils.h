@@ -6,6 +6,14 @@
 #include <osg/Geometry>
 #include <osg/Material>
 
+#include <osg2vsg/convert.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 namespace osg2vsg
 {
     enum GeometryAttributes : uint32_t
@@ -22,8 +30,11 @@ namespace osg2vsg
         TEXCOORD2 = 512,
         TRANSLATE = 1024,
         TRANSLATE_OVERALL = 2048,
+        INTERLEAVED = 4096, // per vertex attributes other than the vertices are packed into a single interleaved array
+        QUANTIZED = 8192,   // normals and tangents are octahedral encoded snorm16, colors unorm8 and texcoords half floats
+        INSTANCE_MATRIX = 16384, // per instance mat4 transforms, from a BIND_OVERALL osg::MatrixfArray assigned as vertex attrib 8
         STANDARD_ATTS = VERTEX | NORMAL | TANGENT | COLOR | TEXCOORD0,
-        ALL_ATTS = VERTEX | NORMAL | NORMAL_OVERALL | TANGENT | TANGENT_OVERALL | COLOR | COLOR_OVERALL | TEXCOORD0 | TEXCOORD1 | TEXCOORD2 | TRANSLATE | TRANSLATE_OVERALL
+        ALL_ATTS = VERTEX | NORMAL | NORMAL_OVERALL | TANGENT | TANGENT_OVERALL | COLOR | COLOR_OVERALL | TEXCOORD0 | TEXCOORD1 | TEXCOORD2 | TRANSLATE | TRANSLATE_OVERALL | INSTANCE_MATRIX
     };
 
     enum AttributeChannels : uint32_t
@@ -35,23 +46,122 @@ namespace osg2vsg
         TEXCOORD0_CHANNEL = 4, //osg 3
         TEXCOORD1_CHANNEL = 5,
         TEXCOORD2_CHANNEL = 6,
-        TRANSLATE_CHANNEL = 7
+        TRANSLATE_CHANNEL = 7,
+        INSTANCE_MATRIX_CHANNEL = 8 // osg 8, the mat4 occupies locations 8 to 11
     };
 
     enum GeometryTarget : uint32_t
     {
         VSG_GEOMETRY,
         VSG_VERTEXINDEXDRAW,
-        VSG_COMMANDS
+        VSG_COMMANDS,
+        VSG_DRAWINDEXEDINDIRECT // SceneBuilder draws the geometries of each state bucket and transform from shared buffers with one DrawIndexedIndirect
+    };
+
+    struct BuildOptions;
+
+    /// counters accumulated while converting geometries, safe to update from multiple conversion threads.
+    struct ConversionStatistics : public vsg::Inherit<vsg::Object, ConversionStatistics>
+    {
+        std::atomic_uint64_t numSplitGeometries = 0;  // geometries split into chunks to use 16 bit or smaller indices
+        std::atomic_uint64_t numChunks = 0;           // chunks created from the split geometries
+        std::atomic_uint64_t indexBytes = 0;          // bytes of index data created
+        std::atomic_uint64_t uint32IndexBytes = 0;    // bytes the same indices would take as 32 bit indices
+        std::atomic_uint64_t vertexBytes = 0;         // bytes of vertex attribute data created
+        std::atomic_uint64_t floatVertexBytes = 0;    // bytes the same vertex attributes would take as float vectors
+        std::atomic_uint64_t numSharedArrays = 0;     // arrays replaced by a byte identical array converted earlier
+        std::atomic_uint64_t numSharedGeometries = 0; // geometries replaced by an identical draw command converted earlier
+        std::atomic_uint64_t sharedBytes = 0;         // bytes of array data saved by sharing
+        std::atomic_uint64_t numBatches = 0;          // merged geometries created by batching
+        std::atomic_uint64_t numBatchedGeometries = 0; // geometries merged into those batches
+        std::atomic_uint64_t numInstancedGeometries = 0; // instanced geometries created from geometries repeated under transforms
+        std::atomic_uint64_t numInstances = 0;        // transformed geometries replaced by those instances
+        std::atomic_uint64_t numChunkedGeometries = 0; // geometries spatially partitioned for culling
+        std::atomic_uint64_t numSpatialChunks = 0;    // chunks created from those geometries
+        std::atomic_uint64_t numIndirectDraws = 0;    // DrawIndexedIndirect commands created
+        std::atomic_uint64_t numIndirectCommands = 0; // draws listed in their indirect command buffers
+        std::atomic_uint64_t numVertexCacheIndices = 0;   // indices reordered for the post transform vertex cache
+        std::atomic_uint64_t vertexCacheMissesBefore = 0; // simulated vertex cache misses of those indices in their original order
+        std::atomic_uint64_t vertexCacheMissesAfter = 0;  // simulated vertex cache misses after reordering
+        std::atomic_uint64_t numFetchOptimizedGeometries = 0; // geometries with their vertices renumbered into fetch order
+        std::atomic_uint64_t numFetchOptimizationSkippedGeometries = 0; // geometries left in their original vertex order as one of their per vertex arrays couldn't be reordered
+        std::atomic_uint64_t numOverdrawOptimizedGeometries = 0; // opaque geometries with their triangle clusters reordered to reduce overdraw
+        std::atomic_uint64_t overdrawPixelsCovered = 0;      // pixels covered when estimating the overdraw of those geometries
+        std::atomic_uint64_t overdrawPixelsShadedBefore = 0; // fragments shaded over those pixels before reordering
+        std::atomic_uint64_t overdrawPixelsShadedAfter = 0;  // fragments shaded over those pixels after reordering
+        std::atomic_uint64_t numLODGeometries = 0;    // geometries given generated levels of detail
+        std::atomic_uint64_t numLODLevels = 0;        // simplified levels generated for those geometries
+        std::atomic_uint64_t numLODTriangles = 0;     // triangles of those geometries at full detail
+        std::atomic_uint64_t numLODLowestTriangles = 0; // triangles of their lowest levels of detail
+        std::atomic_uint64_t numGeneratedTangentArrays = 0; // tangent arrays generated for geometries requiring tangents without providing them
+        std::atomic_uint64_t numCachedTangentArrays = 0;    // geometries reusing tangents generated for an identical geometry
+        std::atomic_uint64_t numTightBounds = 0;       // cull and LOD bounds computed from the converted vertices
+        std::atomic_uint64_t tightRadiusRatioSum = 0;  // sum of their radii relative to the loose bounds they replace, in millionths
+        std::atomic_uint64_t numBatchedBillboards = 0; // billboards gathered from across the scene into batches
+        std::atomic_uint64_t numBillboardBatches = 0;  // spatially clustered billboards created from them, one instanced draw per drawable
+
+        static constexpr double ratioScale = 1000000.0;
+
+        void print(std::ostream& out) const;
+    };
+
+    /// content addressed store of converted arrays and draw commands, so byte identical data converted from separate osg objects is shared rather than duplicated.
+    struct DataCache : public vsg::Inherit<vsg::Object, DataCache>
+    {
+        /// the instance count and draw target along with the interned arrays, indices and child commands a draw command references
+        using CommandKey = std::tuple<uint32_t, uint32_t, std::vector<const vsg::Object*>>;
+
+        std::mutex mutex;
+        std::unordered_multimap<uint64_t, vsg::ref_ptr<vsg::Data>> arrayMap;
+        std::unordered_multimap<uint64_t, vsg::ref_ptr<vsg::Data>> indicesMap; // kept apart from arrayMap so vertex and index buffers are never shared
+        std::map<CommandKey, vsg::ref_ptr<vsg::Command>> commandMap;
+
+        /// return an earlier array with the same type and contents as data, otherwise add data to the cache and return it.
+        vsg::ref_ptr<vsg::Data> share(vsg::ref_ptr<vsg::Data> data, bool indices, ConversionStatistics* statistics);
+
+        /// share every array in the list.
+        void share(vsg::DataList& arrays, ConversionStatistics* statistics);
+
+        /// return an earlier command with the same key, otherwise add command to the cache and return it.
+        vsg::ref_ptr<vsg::Command> share(CommandKey key, vsg::ref_ptr<vsg::Command> command, ConversionStatistics* statistics);
     };
 
-    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2Array* inarray, uint32_t bindOverallPaddingCount);
+    /// tangents generated for geometries, keyed by the content of the arrays and indices they were generated from so identical geometries converted separately share them.
+    struct TangentCache : public vsg::Inherit<vsg::Object, TangentCache>
+    {
+        struct Entry
+        {
+            vsg::DataList sources;
+            vsg::ref_ptr<vsg::vec4Array> tangents;
+        };
+
+        std::mutex mutex;
+        std::unordered_multimap<uint64_t, Entry> entries;
 
-    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3Array* inarray, uint32_t bindOverallPaddingCount);
+        /// return the tangents of an earlier entry with the same sources, otherwise add an entry with the tangents returned by generate.
+        vsg::ref_ptr<vsg::vec4Array> getOrCreate(const vsg::DataList& sources, const std::function<vsg::ref_ptr<vsg::vec4Array>()>& generate, ConversionStatistics* statistics);
+    };
 
-    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4Array* inarray, uint32_t bindOverallPaddingCount);
+    /// generate tangents for the triangles from vec3 vertices and normals and vec2 texcoords, using the BuildOptions::tangentCache when assigned. Returns null for unsupported arrays.
+    vsg::ref_ptr<vsg::Data> createTangents(const vsg::ref_ptr<vsg::Data>& vertices, const vsg::ref_ptr<vsg::Data>& normals, const vsg::ref_ptr<vsg::Data>& texcoords, const std::vector<uint32_t>& triangles, const BuildOptions& buildOptions);
 
-    vsg::ref_ptr<vsg::Data> convertToVsg(const osg::Array* inarray, uint32_t bindOverallPaddingCount);
+    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::vec2Array> convertToVsg(const osg::Vec2dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::vec3Array> convertToVsg(const osg::Vec3dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::vec4Array> convertToVsg(const osg::Vec4dArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::ubvec4Array> convertToVsg(const osg::Vec4ubArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::mat4Array> convertToVsg(const osg::MatrixfArray* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
+
+    vsg::ref_ptr<vsg::Data> convertToVsg(const osg::Array* inarray, uint32_t bindOverallPaddingCount, bool zeroCopy = false);
 
     uint32_t calculateAttributesMask(const osg::Geometry* geometry);
 
@@ -63,6 +173,38 @@ namespace osg2vsg
 
     vsg::ref_ptr<vsg::materialValue> convertToMaterialValue(const osg::Material* material);
 
-    vsg::ref_ptr<vsg::Command> convertToVsg(osg::Geometry* geometry, uint32_t requiredAttributesMask, GeometryTarget geometryTarget);
+    /// opaque geometries can have their triangles reordered to reduce overdraw when BuildOptions::optimizeOverdraw is set.
+    vsg::ref_ptr<vsg::Command> convertToVsg(osg::Geometry* geometry, uint32_t requiredAttributesMask, const BuildOptions& buildOptions, bool opaque = false);
+
+    /// concatenate the arrays and indices of the VertexIndexDraws found in leaves, directly or as children of vsg::Commands, into one shared vertex and index
+    /// buffer pair drawn by a DrawIndexedIndirect with a command per draw. Draws with incompatible arrays and other leaves are appended unchanged.
+    /// Drawing more than one command requires the multiDrawIndirect device feature, and when the draws have BIND_OVERALL arrays, which each command
+    /// addresses with its firstInstance, the drawIndirectFirstInstance device feature too. Interleaved arrays are concatenated using their byte stride.
+    vsg::ref_ptr<vsg::Command> createDrawIndexedIndirect(const std::vector<vsg::ref_ptr<vsg::Command>>& leaves, ConversionStatistics* statistics);
+
+    /// when BuildOptions::generateLODs is set and command is a VertexIndexDraw of more than lodTriangleThreshold triangles, return a vsg::LOD of it
+    /// and progressively simplified levels that share its vertex arrays and one index buffer, each level drawing its own range of the indices.
+    /// otherwise return command.
+    vsg::ref_ptr<vsg::Node> createLODs(vsg::ref_ptr<vsg::Command> command, const BuildOptions& buildOptions);
+
+    /// binary tree of spatial chunks of a geometry, nodes[0] is the root, leaves hold a chunk geometry and interior nodes the indices of their two children.
+    struct SpatialChunks
+    {
+        struct Node
+        {
+            osg::BoundingBoxd bound;
+            osg::ref_ptr<osg::Geometry> geometry;
+            std::vector<size_t> children;
+        };
+
+        std::vector<Node> nodes;
+    };
+
+    /// partition the triangles of geometry into chunks of at most maxTriangles triangles and, when maxExtent is greater than 0, at most maxExtent across.
+    /// returns no nodes when the geometry is within the limits or can't be partitioned, such as when it has BIND_OVERALL arrays.
+    SpatialChunks partitionGeometry(const osg::Geometry& geometry, uint32_t maxTriangles, double maxExtent);
+
+    /// merge the triangles of geometries into a new geometry with concatenated arrays and 32 bit indices, the geometries must have the same array types and normalization all bound per vertex.
+    osg::ref_ptr<osg::Geometry> mergeGeometries(const std::vector<osg::Geometry*>& geometries);
 
 } // namespace osg2vsg
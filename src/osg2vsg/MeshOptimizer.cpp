@@ -0,0 +1,722 @@
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace osg2vsg;
+
+namespace
+{
+    const uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+
+    // the triangles using each vertex, stored as one flat list with an offset per vertex
+    struct VertexTriangles
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        VertexTriangles(const std::vector<uint32_t>& indices, size_t vertexCount) :
+            offsets(vertexCount + 1, 0),
+            triangles(indices.size())
+        {
+            for (auto index : indices) ++offsets[index + 1];
+            for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+            std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+    };
+
+    // FIFO vertex cache simulation that can be flushed in constant time by advancing the time stamp past the cache size
+    struct VertexCache
+    {
+        std::vector<uint32_t> timeStamps;
+        uint32_t cacheSize;
+        uint32_t timeStamp;
+
+        VertexCache(size_t vertexCount, uint32_t in_cacheSize) :
+            timeStamps(vertexCount, 0),
+            cacheSize(in_cacheSize),
+            timeStamp(in_cacheSize + 1)
+        {
+        }
+
+        void flush() { timeStamp += cacheSize + 1; }
+
+        uint32_t addTriangle(const uint32_t* triangle)
+        {
+            uint32_t misses = 0;
+            for (size_t i = 0; i < 3; ++i)
+            {
+                uint32_t vertex = triangle[i];
+                if (timeStamp - timeStamps[vertex] > cacheSize)
+                {
+                    timeStamps[vertex] = timeStamp++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+    };
+} // namespace
+
+std::vector<uint32_t> osg2vsg::optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) return indices;
+
+    VertexTriangles vertexTriangles(indices, vertexCount);
+
+    // number of triangles still to be emitted that use each vertex
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) liveTriangles[v] = vertexTriangles.offsets[v + 1] - vertexTriangles.offsets[v];
+
+    std::vector<uint32_t> cacheTimeStamps(vertexCount, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(numTriangles * 3);
+
+    uint32_t timeStamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    // once the fanning vertex has no triangles left continue from a recently used vertex, falling back to the next vertex in input order
+    auto skipDeadEnd = [&]() -> uint32_t {
+        while (!deadEndStack.empty())
+        {
+            uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[vertex] > 0) return vertex;
+        }
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveTriangles[cursor] > 0) return static_cast<uint32_t>(cursor);
+        }
+        return unassigned;
+    };
+
+    uint32_t fanningVertex = skipDeadEnd();
+    while (fanningVertex != unassigned)
+    {
+        candidates.clear();
+
+        for (auto t = vertexTriangles.offsets[fanningVertex]; t < vertexTriangles.offsets[fanningVertex + 1]; ++t)
+        {
+            uint32_t triangle = vertexTriangles.triangles[t];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                uint32_t vertex = indices[triangle * 3 + i];
+                optimized.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+
+                if (timeStamp - cacheTimeStamps[vertex] > cacheSize) cacheTimeStamps[vertex] = timeStamp++;
+            }
+        }
+
+        // prefer the candidate that will still be in the cache after its remaining triangles are emitted, and has been in it the longest
+        uint32_t bestVertex = unassigned;
+        int64_t bestPriority = -1;
+        for (auto vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0) continue;
+
+            int64_t priority = 0;
+            if (timeStamp - cacheTimeStamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) priority = timeStamp - cacheTimeStamps[vertex];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = vertex;
+            }
+        }
+
+        fanningVertex = (bestVertex != unassigned) ? bestVertex : skipDeadEnd();
+    }
+
+    return optimized;
+}
+
+size_t osg2vsg::countVertexCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    // a vertex is in the FIFO cache if fewer than cacheSize misses have happened since it was last loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    std::vector<bool> loaded(vertexCount, false);
+    size_t misses = 0;
+    for (auto index : indices)
+    {
+        if (!loaded[index] || misses - loadedAt[index] >= cacheSize)
+        {
+            loaded[index] = true;
+            loadedAt[index] = misses++;
+        }
+    }
+    return misses;
+}
+
+std::vector<uint32_t> osg2vsg::optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    std::vector<uint32_t> newIndex(vertexCount, unassigned);
+    std::vector<uint32_t> vertices;
+    vertices.reserve(vertexCount);
+
+    for (auto& index : indices)
+    {
+        if (newIndex[index] == unassigned)
+        {
+            newIndex[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(index);
+        }
+        index = newIndex[index];
+    }
+
+    // keep the unreferenced vertices so the arrays still hold every vertex of the source geometry
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (newIndex[v] == unassigned) vertices.push_back(static_cast<uint32_t>(v));
+    }
+
+    return vertices;
+}
+
+std::vector<uint32_t> osg2vsg::optimizeOverdraw(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount, float threshold, uint32_t cacheSize)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles < 2) return indices;
+
+    // thresholds below 1 would never be reached by a whole cluster
+    threshold = std::max(threshold, 1.0f);
+
+    VertexCache cache(vertexCount, cacheSize);
+
+    // a triangle missing on all three vertices usually starts a new patch of the mesh
+    std::vector<size_t> hardBoundaries;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        if (cache.addTriangle(&indices[t * 3]) == 3 || t == 0) hardBoundaries.push_back(t);
+    }
+    hardBoundaries.push_back(numTriangles);
+
+    // split each patch once the miss rate since the last split is within threshold of the patch's own miss rate
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        size_t start = hardBoundaries[h];
+        size_t end = hardBoundaries[h + 1];
+
+        cache.flush();
+        uint32_t patchMisses = 0;
+        for (size_t t = start; t < end; ++t) patchMisses += cache.addTriangle(&indices[t * 3]);
+        float patchThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        uint32_t misses = 0;
+        size_t clusterStart = start;
+        for (size_t t = start; t < end; ++t)
+        {
+            misses += cache.addTriangle(&indices[t * 3]);
+            if (t + 1 < end && static_cast<float>(misses) <= patchThreshold * static_cast<float>(t + 1 - clusterStart))
+            {
+                clusterStart = t + 1;
+                clusters.push_back(clusterStart);
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+
+    size_t numClusters = clusters.size() - 1;
+    if (numClusters < 2) return indices;
+
+    // centre of the mesh weighted by the area of the triangles
+    auto triangleCross = [&](size_t t) {
+        const auto& p0 = positions[indices[t * 3]];
+        return vsg::cross(positions[indices[t * 3 + 1]] - p0, positions[indices[t * 3 + 2]] - p0);
+    };
+    auto triangleCentre = [&](size_t t) {
+        return (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0f;
+    };
+
+    vsg::dvec3 meshCentre;
+    double meshArea = 0.0;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        double area = vsg::length(triangleCross(t));
+        meshCentre += vsg::dvec3(triangleCentre(t)) * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0) meshCentre /= meshArea;
+
+    // clusters further out along their average normal are more likely to occlude the rest of the mesh
+    std::vector<double> clusterKeys(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        vsg::dvec3 normal;
+        vsg::dvec3 centre;
+        double area = 0.0;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            vsg::dvec3 cross(triangleCross(t));
+            double triangleArea = vsg::length(cross);
+            normal += cross;
+            centre += vsg::dvec3(triangleCentre(t)) * triangleArea;
+            area += triangleArea;
+        }
+
+        double normalLength = vsg::length(normal);
+        clusterKeys[c] = (area > 0.0 && normalLength > 0.0) ? vsg::dot(centre / area - meshCentre, normal / normalLength) : 0.0;
+    }
+
+    std::vector<size_t> clusterOrder(numClusters);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t lhs, size_t rhs) { return clusterKeys[lhs] > clusterKeys[rhs]; });
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+    for (auto c : clusterOrder)
+    {
+        optimized.insert(optimized.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    return optimized;
+}
+
+OverdrawStatistics osg2vsg::analyzeOverdraw(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount, uint32_t resolution)
+{
+    OverdrawStatistics overdraw;
+    if (indices.empty() || resolution == 0) return overdraw;
+
+    vsg::vec3 bb_min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    vsg::vec3 bb_max(-bb_min);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            bb_min[i] = std::min(bb_min[i], positions[v][i]);
+            bb_max[i] = std::max(bb_max[i], positions[v][i]);
+        }
+    }
+
+    std::vector<float> depthBuffer(resolution * resolution);
+    std::vector<vsg::vec3> viewPositions(vertexCount);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (float direction : {1.0f, -1.0f})
+        {
+            // map the two axes across the view onto the pixel grid and the view axis onto depth, nearest first
+            int u_axis = (axis + 1) % 3;
+            int v_axis = (axis + 2) % 3;
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                const auto& p = positions[v];
+                auto scale = [&](int i) { return (bb_max[i] > bb_min[i]) ? (p[i] - bb_min[i]) / (bb_max[i] - bb_min[i]) : 0.5f; };
+                viewPositions[v].set(scale(u_axis) * resolution, scale(v_axis) * resolution, direction * scale(axis));
+            }
+
+            std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::max());
+
+            for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            {
+                const auto& p0 = viewPositions[indices[t]];
+                const auto& p1 = viewPositions[indices[t + 1]];
+                const auto& p2 = viewPositions[indices[t + 2]];
+
+                // counter clockwise triangles are front facing, mirrored views flip the winding
+                float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+                if (area * direction >= 0.0f) continue;
+
+                int x_min = std::max(0, static_cast<int>(std::floor(std::min({p0.x, p1.x, p2.x}))));
+                int x_max = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({p0.x, p1.x, p2.x}))));
+                int y_min = std::max(0, static_cast<int>(std::floor(std::min({p0.y, p1.y, p2.y}))));
+                int y_max = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({p0.y, p1.y, p2.y}))));
+
+                for (int y = y_min; y <= y_max; ++y)
+                {
+                    for (int x = x_min; x <= x_max; ++x)
+                    {
+                        float px = static_cast<float>(x) + 0.5f;
+                        float py = static_cast<float>(y) + 0.5f;
+                        float w0 = ((p1.x - px) * (p2.y - py) - (p2.x - px) * (p1.y - py)) / area;
+                        float w1 = ((p2.x - px) * (p0.y - py) - (p0.x - px) * (p2.y - py)) / area;
+                        float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                        float depth = w0 * p0.z + w1 * p1.z + w2 * p2.z;
+                        float& pixelDepth = depthBuffer[y * resolution + x];
+                        if (depth < pixelDepth)
+                        {
+                            if (pixelDepth == std::numeric_limits<float>::max()) ++overdraw.pixelsCovered;
+                            pixelDepth = depth;
+                            ++overdraw.pixelsShaded;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return overdraw;
+}
+
+std::vector<vsg::vec4> osg2vsg::generateTangents(const std::vector<uint32_t>& indices, const vsg::vec3* positions, const vsg::vec3* normals, const vsg::vec2* texcoords, size_t vertexCount)
+{
+    std::vector<vsg::vec3> accumulatedTangents(vertexCount);
+    std::vector<vsg::vec3> accumulatedBitangents(vertexCount);
+    std::vector<vsg::vec3> vertexNormals(vertexCount);
+
+    auto projectOnto = [](const vsg::vec3& v, const vsg::vec3& n) { return v - n * vsg::dot(n, v); };
+    auto normalizeOr = [](const vsg::vec3& v, const vsg::vec3& fallback) {
+        float length = vsg::length(v);
+        return (length > 0.0f) ? v / length : fallback;
+    };
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        const uint32_t corners[3] = {indices[t], indices[t + 1], indices[t + 2]};
+        const auto& p0 = positions[corners[0]];
+        const auto& p1 = positions[corners[1]];
+        const auto& p2 = positions[corners[2]];
+        const auto& uv0 = texcoords[corners[0]];
+        const auto& uv1 = texcoords[corners[1]];
+        const auto& uv2 = texcoords[corners[2]];
+
+        vsg::vec3 edge1 = p1 - p0;
+        vsg::vec3 edge2 = p2 - p0;
+        vsg::vec3 faceNormal = normalizeOr(vsg::cross(edge1, edge2), vsg::vec3(0.0f, 0.0f, 1.0f));
+        if (!normals)
+        {
+            for (auto corner : corners) vertexNormals[corner] += faceNormal;
+        }
+
+        // triangles without a usable texture mapping don't contribute
+        float s1 = uv1.x - uv0.x, s2 = uv2.x - uv0.x;
+        float t1 = uv1.y - uv0.y, t2 = uv2.y - uv0.y;
+        float det = s1 * t2 - s2 * t1;
+        if (det == 0.0f) continue;
+
+        float orientation = (det > 0.0f) ? 1.0f : -1.0f;
+        vsg::vec3 faceTangent = (edge1 * t2 - edge2 * t1) * orientation;
+        vsg::vec3 faceBitangent = (edge2 * s1 - edge1 * s2) * orientation;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            uint32_t corner = corners[i];
+            const auto& n = normals ? normals[corner] : faceNormal;
+
+            vsg::vec3 toNext = positions[corners[(i + 1) % 3]] - positions[corner];
+            vsg::vec3 toPrevious = positions[corners[(i + 2) % 3]] - positions[corner];
+            float cosAngle = vsg::dot(normalizeOr(toNext, {}), normalizeOr(toPrevious, {}));
+            float angle = std::acos(std::clamp(cosAngle, -1.0f, 1.0f));
+
+            accumulatedTangents[corner] += normalizeOr(projectOnto(faceTangent, n), {}) * angle;
+            accumulatedBitangents[corner] += normalizeOr(projectOnto(faceBitangent, n), {}) * angle;
+        }
+    }
+
+    std::vector<vsg::vec4> tangents(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vsg::vec3 n = normals ? normals[v] : normalizeOr(vertexNormals[v], vsg::vec3(0.0f, 0.0f, 1.0f));
+
+        // vertices without a contribution get an arbitrary tangent perpendicular to the normal
+        vsg::vec3 fallback = normalizeOr(projectOnto((std::abs(n.x) < 0.9f) ? vsg::vec3(1.0f, 0.0f, 0.0f) : vsg::vec3(0.0f, 1.0f, 0.0f), n), vsg::vec3(1.0f, 0.0f, 0.0f));
+        vsg::vec3 tangent = normalizeOr(projectOnto(accumulatedTangents[v], n), fallback);
+
+        float handedness = (vsg::dot(vsg::cross(n, tangent), accumulatedBitangents[v]) < 0.0f) ? -1.0f : 1.0f;
+        tangents[v].set(tangent.x, tangent.y, tangent.z, handedness);
+    }
+    return tangents;
+}
+
+void osg2vsg::MeshSimplifier::Quadric::addPlane(const vsg::dvec3& n, double d, double weight)
+{
+    a00 += weight * n.x * n.x;
+    a01 += weight * n.x * n.y;
+    a02 += weight * n.x * n.z;
+    a11 += weight * n.y * n.y;
+    a12 += weight * n.y * n.z;
+    a22 += weight * n.z * n.z;
+    b0 += weight * n.x * d;
+    b1 += weight * n.y * d;
+    b2 += weight * n.z * d;
+    c += weight * d * d;
+}
+
+void osg2vsg::MeshSimplifier::Quadric::add(const Quadric& rhs)
+{
+    a00 += rhs.a00;
+    a01 += rhs.a01;
+    a02 += rhs.a02;
+    a11 += rhs.a11;
+    a12 += rhs.a12;
+    a22 += rhs.a22;
+    b0 += rhs.b0;
+    b1 += rhs.b1;
+    b2 += rhs.b2;
+    c += rhs.c;
+}
+
+double osg2vsg::MeshSimplifier::Quadric::error(const vsg::dvec3& p) const
+{
+    double rx = a00 * p.x + a01 * p.y + a02 * p.z;
+    double ry = a01 * p.x + a11 * p.y + a12 * p.z;
+    double rz = a02 * p.x + a12 * p.y + a22 * p.z;
+    return std::abs(p.x * rx + p.y * ry + p.z * rz + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c);
+}
+
+osg2vsg::MeshSimplifier::MeshSimplifier(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount) :
+    originalIndices(indices)
+{
+    originalIndices.resize(indices.size() - indices.size() % 3);
+
+    // weld vertices with identical positions by sorting them
+    std::vector<uint32_t> sortedVertices(vertexCount);
+    std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+    auto lessPosition = [&](uint32_t lhs, uint32_t rhs) {
+        const auto& l = positions[lhs];
+        const auto& r = positions[rhs];
+        if (l.x != r.x) return l.x < r.x;
+        if (l.y != r.y) return l.y < r.y;
+        return l.z < r.z;
+    };
+    std::sort(sortedVertices.begin(), sortedVertices.end(), lessPosition);
+
+    vertexPositions.resize(vertexCount);
+    positionVertices = sortedVertices;
+    for (size_t i = 0; i < sortedVertices.size(); ++i)
+    {
+        if (i == 0 || lessPosition(sortedVertices[i - 1], sortedVertices[i]))
+        {
+            positionVertexOffsets.push_back(static_cast<uint32_t>(i));
+            points.emplace_back(positions[sortedVertices[i]]);
+        }
+        vertexPositions[sortedVertices[i]] = static_cast<uint32_t>(points.size() - 1);
+    }
+    positionVertexOffsets.push_back(static_cast<uint32_t>(vertexCount));
+
+    VertexTriangles originalVertexTriangles(originalIndices, vertexCount);
+    vertexTriangleOffsets = std::move(originalVertexTriangles.offsets);
+    vertexTriangles = std::move(originalVertexTriangles.triangles);
+
+    collapsedTo.resize(points.size());
+    std::iota(collapsedTo.begin(), collapsedTo.end(), 0);
+
+    // each position's quadric sums the planes of its triangles weighted by their area, triangles degenerate once welded are dropped
+    quadrics.resize(points.size());
+    for (size_t t = 0; t < originalIndices.size() / 3; ++t)
+    {
+        uint32_t p0 = vertexPositions[originalIndices[t * 3]];
+        uint32_t p1 = vertexPositions[originalIndices[t * 3 + 1]];
+        uint32_t p2 = vertexPositions[originalIndices[t * 3 + 2]];
+        if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+        triangles.insert(triangles.end(), {p0, p1, p2});
+        triangleSources.push_back(static_cast<uint32_t>(t));
+
+        auto normal = vsg::cross(points[p1] - points[p0], points[p2] - points[p0]);
+        double length = vsg::length(normal);
+        if (length == 0.0) continue;
+
+        normal /= length;
+        double area = length * 0.5;
+        double distance = -vsg::dot(normal, points[p0]);
+        for (auto p : {p0, p1, p2}) quadrics[p].addPlane(normal, distance, area);
+    }
+}
+
+size_t osg2vsg::MeshSimplifier::simplify(size_t targetTriangles)
+{
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    std::vector<Collapse> collapses;
+    std::vector<bool> locked(points.size());
+    std::vector<bool> touched(points.size());
+
+    while (triangles.size() / 3 > targetTriangles)
+    {
+        size_t numTriangles = triangles.size() / 3;
+
+        // every edge of a closed manifold surface is used by two triangles, lock the ends of any other edges so borders stay in place
+        edges.clear();
+        for (size_t t = 0; t < numTriangles; ++t)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                uint32_t p0 = triangles[t * 3 + i];
+                uint32_t p1 = triangles[t * 3 + (i + 1) % 3];
+                edges.emplace_back(std::min(p0, p1), std::max(p0, p1));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::fill(locked.begin(), locked.end(), false);
+        collapses.clear();
+        for (size_t begin = 0, end = 0; begin < edges.size(); begin = end)
+        {
+            while (end < edges.size() && edges[end] == edges[begin]) ++end;
+
+            auto [p0, p1] = edges[begin];
+            if (end - begin != 2)
+            {
+                locked[p0] = true;
+                locked[p1] = true;
+            }
+        }
+        for (size_t begin = 0, end = 0; begin < edges.size(); begin = end)
+        {
+            while (end < edges.size() && edges[end] == edges[begin]) ++end;
+
+            auto [p0, p1] = edges[begin];
+            if (end - begin != 2 || (locked[p0] && locked[p1])) continue;
+
+            Quadric quadric = quadrics[p0];
+            quadric.add(quadrics[p1]);
+
+            // collapse in whichever direction moves the surface least
+            double cost0 = locked[p0] ? std::numeric_limits<double>::max() : quadric.error(points[p1]);
+            double cost1 = locked[p1] ? std::numeric_limits<double>::max() : quadric.error(points[p0]);
+            if (cost0 <= cost1)
+                collapses.push_back(Collapse{p0, p1, cost0});
+            else
+                collapses.push_back(Collapse{p1, p0, cost1});
+        }
+        if (collapses.empty()) break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+        // triangles using each position, so collapses that would flip a neighbouring triangle can be rejected
+        VertexTriangles positionTriangles(triangles, points.size());
+
+        auto position = [&](uint32_t p) -> const vsg::dvec3& { return points[collapsedTo[p]]; };
+        auto flips = [&](const Collapse& collapse) {
+            for (auto i = positionTriangles.offsets[collapse.from]; i < positionTriangles.offsets[collapse.from + 1]; ++i)
+            {
+                const uint32_t* triangle = &triangles[positionTriangles.triangles[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) continue;
+
+                vsg::dvec3 before[3], after[3];
+                for (size_t v = 0; v < 3; ++v)
+                {
+                    before[v] = position(triangle[v]);
+                    after[v] = (triangle[v] == collapse.from) ? points[collapse.to] : before[v];
+                }
+                auto normalBefore = vsg::cross(before[1] - before[0], before[2] - before[0]);
+                auto normalAfter = vsg::cross(after[1] - after[0], after[2] - after[0]);
+                if (vsg::dot(normalBefore, normalAfter) <= 0.0) return true;
+            }
+            return false;
+        };
+
+        // apply the cheapest collapses, each position at most once per pass, until enough triangles will have been removed
+        std::fill(touched.begin(), touched.end(), false);
+        size_t numToRemove = numTriangles - targetTriangles;
+        size_t numRemoved = 0;
+        size_t numCollapses = 0;
+        for (auto& collapse : collapses)
+        {
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse)) continue;
+
+            collapsedTo[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            touched[collapse.from] = true;
+            touched[collapse.to] = true;
+            ++numCollapses;
+
+            // a manifold edge collapse removes the two triangles sharing the edge
+            numRemoved += 2;
+            if (numRemoved >= numToRemove) break;
+        }
+        if (numCollapses == 0) break;
+
+        size_t numRemaining = 0;
+        for (size_t t = 0; t < numTriangles; ++t)
+        {
+            uint32_t p0 = collapsedTo[triangles[t * 3]];
+            uint32_t p1 = collapsedTo[triangles[t * 3 + 1]];
+            uint32_t p2 = collapsedTo[triangles[t * 3 + 2]];
+            if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+            triangles[numRemaining * 3] = p0;
+            triangles[numRemaining * 3 + 1] = p1;
+            triangles[numRemaining * 3 + 2] = p2;
+            triangleSources[numRemaining] = triangleSources[t];
+            ++numRemaining;
+        }
+        triangles.resize(numRemaining * 3);
+        triangleSources.resize(numRemaining);
+    }
+
+    return triangles.size() / 3;
+}
+
+std::vector<uint32_t> osg2vsg::MeshSimplifier::indices() const
+{
+    auto sharesTriangle = [&](uint32_t v0, uint32_t v1) {
+        for (auto i = vertexTriangleOffsets[v0]; i < vertexTriangleOffsets[v0 + 1]; ++i)
+        {
+            const uint32_t* triangle = &originalIndices[vertexTriangles[i] * 3];
+            if (triangle[0] == v1 || triangle[1] == v1 || triangle[2] == v1) return true;
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> simplified(triangles.size());
+    for (size_t t = 0; t < triangleSources.size(); ++t)
+    {
+        const uint32_t* source = &originalIndices[triangleSources[t] * 3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            uint32_t vertex = source[i];
+            uint32_t p = triangles[t * 3 + i];
+            if (vertexPositions[vertex] != p)
+            {
+                // of the vertices at the position collapsed onto prefer one on the same side of any attribute seam, found by sharing an original triangle
+                uint32_t other1 = source[(i + 1) % 3];
+                uint32_t other2 = source[(i + 2) % 3];
+                uint32_t replacement = positionVertices[positionVertexOffsets[p]];
+                for (auto j = positionVertexOffsets[p]; j < positionVertexOffsets[p + 1]; ++j)
+                {
+                    uint32_t candidate = positionVertices[j];
+                    if (sharesTriangle(candidate, vertex) || sharesTriangle(candidate, other1) || sharesTriangle(candidate, other2))
+                    {
+                        replacement = candidate;
+                        break;
+                    }
+                }
+                vertex = replacement;
+            }
+            simplified[t * 3 + i] = vertex;
+        }
+    }
+    return simplified;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include <vsg/maths/vec2.h>
+#include <vsg/maths/vec3.h>
+#include <vsg/maths/vec4.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace osg2vsg
+{
+
+    /// default size of the FIFO post transform vertex cache modelled by the mesh optimizations
+    constexpr uint32_t defaultVertexCacheSize = 16;
+
+    /// reorder the triangles in indices for the post transform vertex cache using Tipsify, Sander et al. 2007, which runs in linear time.
+    std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize);
+
+    /// number of misses of a FIFO vertex cache of cacheSize entries when drawing the triangles in indices.
+    size_t countVertexCacheMisses(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize);
+
+    /// renumber the vertices in the order indices first references them, so vertex fetches walk memory sequentially.
+    /// returns the original index of each renumbered vertex, vertices that indices don't reference follow the referenced ones in their original order.
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    /// reorder clusters of the vertex cache ordered triangles in indices so the clusters facing away from the mesh centre are drawn first, letting early depth tests reject more of the fragments hidden behind them, Sander et al. 2007.
+    /// clusters start wherever the vertex cache misses, and are split further once their miss rate falls within threshold times that of the whole cluster,
+    /// so higher thresholds give more, smaller clusters that sort better at the expense of vertex cache efficiency.
+    std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount, float threshold, uint32_t cacheSize = defaultVertexCacheSize);
+
+    struct OverdrawStatistics
+    {
+        size_t pixelsCovered = 0; // pixels covered by at least one front facing triangle
+        size_t pixelsShaded = 0;  // fragments passing the depth test, including those later overwritten
+    };
+
+    /// estimate overdraw by rasterizing the front facing triangles in draw order, with depth testing, from the six axis aligned views of their bounding box.
+    OverdrawStatistics analyzeOverdraw(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount, uint32_t resolution = 128);
+
+    /// generate per vertex tangents following the MikkTSpace conventions: the texture space tangent and bitangent of each triangle are projected onto the
+    /// plane of each corner's normal and accumulated weighted by the corner angle, the bitangent is recovered in the shader as cross(normal, tangent.xyz) * tangent.w.
+    /// normals may be null to use the triangle normals. Unlike MikkTSpace vertices aren't split where tangent spaces diverge, the existing indexing is kept.
+    std::vector<vsg::vec4> generateTangents(const std::vector<uint32_t>& indices, const vsg::vec3* positions, const vsg::vec3* normals, const vsg::vec2* texcoords, size_t vertexCount);
+
+    /// simplifies a triangle mesh by quadric error edge collapses, Garland and Heckbert 1997. Vertices are only collapsed onto other existing vertices
+    /// so every simplified level indexes the original vertex arrays. Vertices at the same position are welded while simplifying so attribute seams
+    /// collapse together, vertices on borders and non manifold edges are kept in place to preserve the outline of open meshes.
+    struct MeshSimplifier
+    {
+        MeshSimplifier(const std::vector<uint32_t>& indices, const vsg::vec3* positions, size_t vertexCount);
+
+        /// collapse edges until at most targetTriangles remain or no more can be collapsed, returns the number of triangles remaining.
+        /// successive calls continue from the previous result so a chain of levels can be generated with decreasing targets.
+        size_t simplify(size_t targetTriangles);
+
+        /// indices of the remaining triangles into the original vertices.
+        std::vector<uint32_t> indices() const;
+
+    protected:
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+
+            void addPlane(const vsg::dvec3& normal, double distance, double weight);
+            void add(const Quadric& rhs);
+            double error(const vsg::dvec3& p) const;
+        };
+
+        std::vector<uint32_t> originalIndices;
+        std::vector<uint32_t> vertexPositions;         // welded position of each original vertex
+        std::vector<uint32_t> positionVertexOffsets;   // positionVertices[positionVertexOffsets[p]] to positionVertices[positionVertexOffsets[p + 1]] are the vertices at position p
+        std::vector<uint32_t> positionVertices;
+        std::vector<uint32_t> vertexTriangleOffsets;   // the same layout listing the original triangles using each vertex
+        std::vector<uint32_t> vertexTriangles;
+        std::vector<vsg::dvec3> points;
+        std::vector<Quadric> quadrics;
+        std::vector<uint32_t> collapsedTo;             // position each position was collapsed onto, itself if it remains
+        std::vector<uint32_t> triangles;               // remaining triangles as welded positions
+        std::vector<uint32_t> triangleSources;         // original triangle of each remaining triangle
+    };
+
+} // namespace osg2vsg
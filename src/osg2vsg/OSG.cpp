@@ -75,6 +75,12 @@ bool OSG::getFeatures(Features& features) const
     features.optionNameTypeMap[OSG::original_converter] = vsg::type_name<bool>();
     features.optionNameTypeMap[OSG::read_build_options] = vsg::type_name<std::string>();
     features.optionNameTypeMap[OSG::write_build_options] = vsg::type_name<std::string>();
+    features.optionNameTypeMap[OSG::read_pipeline_manifest] = vsg::type_name<std::string>();
+    features.optionNameTypeMap[OSG::write_pipeline_manifest] = vsg::type_name<std::string>();
+    features.optionNameTypeMap[OSG::zero_copy_arrays] = vsg::type_name<bool>();
+    features.optionNameTypeMap[OSG::pipeline_cache_capacity] = vsg::type_name<uint32_t>();
+    features.optionNameTypeMap[OSG::share_identical_data] = vsg::type_name<bool>();
+    features.optionNameTypeMap[OSG::collect_statistics] = vsg::type_name<bool>();
 
     return true;
 }
@@ -85,6 +91,12 @@ bool OSG::readOptions(vsg::Options& options, vsg::CommandLine& arguments) const
     bool result = arguments.readAndAssign<bool>(OSG::original_converter, &options);
     result = arguments.readAndAssign<std::string>(OSG::read_build_options, &options) || result;
     result = arguments.readAndAssign<std::string>(OSG::write_build_options, &options) || result;
+    result = arguments.readAndAssign<std::string>(OSG::read_pipeline_manifest, &options) || result;
+    result = arguments.readAndAssign<std::string>(OSG::write_pipeline_manifest, &options) || result;
+    result = arguments.readAndAssign<bool>(OSG::zero_copy_arrays, &options) || result;
+    result = arguments.readAndAssign<uint32_t>(OSG::pipeline_cache_capacity, &options) || result;
+    result = arguments.readAndAssign<bool>(OSG::share_identical_data, &options) || result;
+    result = arguments.readAndAssign<bool>(OSG::collect_statistics, &options) || result;
     return result;
 }
 
@@ -155,7 +167,12 @@ vsg::ref_ptr<vsg::Object> OSG::read(const vsg::Path& filename, vsg::ref_ptr<cons
     osg::ref_ptr<osg::Object> object = rr.takeObject();
     if (osg::Node* osg_scene = object->asNode(); osg_scene != nullptr)
     {
-        return osg2vsg::convert(*osg_scene, options);
+        auto getOrCreateTaskPool = [this](uint32_t numThreads) {
+            std::lock_guard<std::mutex> guard(taskPoolMutex);
+            if (!taskPool) taskPool = TaskPool::create(numThreads);
+            return taskPool;
+        };
+        return osg2vsg::convert(*osg_scene, options, pipelineCache, getOrCreateTaskPool);
     }
     else if (osg::Image* osg_image = dynamic_cast<osg::Image*>(object.get()); osg_image != nullptr)
     {
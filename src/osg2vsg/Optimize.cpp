@@ -176,3 +176,228 @@ void OptimizeOsgBillboards::optimize()
         }
     }
 }
+
+BatchOsgBillboards::BatchOsgBillboards(uint32_t in_maxBillboardsPerBatch, double in_maxBatchExtent) :
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+    maxBillboardsPerBatch(in_maxBillboardsPerBatch),
+    maxBatchExtent(in_maxBatchExtent)
+{
+}
+
+bool BatchOsgBillboards::foldable(const osg::Node& node) const
+{
+    // nodes reached by more than one path, masked or animated can't be folded into the positions and state of the billboards below them
+    return scope && node.getNumParents() == 1 && node.getNodeMask() == 0xffffffff && node.getDataVariance() != osg::Object::DYNAMIC &&
+           !node.getUpdateCallback() && !node.getEventCallback() && !node.getCullCallback();
+}
+
+void BatchOsgBillboards::traverseScope(osg::Group* newScope, osg::Node& node)
+{
+    // gather each scope once, it's only left out of the graph after batch() so later paths to it would gather its billboards again
+    if (newScope && scopeIndices.count(newScope) > 0) return;
+
+    osg::Group* previousScope = scope;
+    osg::Matrix previousMatrix = matrix;
+    StateSets previousStateSets;
+    previousStateSets.swap(stateSets);
+
+    scope = newScope;
+    matrix.makeIdentity();
+
+    if (scope)
+    {
+        scopeIndices[scope] = scopes.size();
+        scopes.emplace_back().group = scope;
+    }
+
+    traverse(node);
+
+    scope = previousScope;
+    matrix = previousMatrix;
+    stateSets.swap(previousStateSets);
+}
+
+void BatchOsgBillboards::apply(osg::Group& group)
+{
+    if (typeid(group) != typeid(osg::Group))
+    {
+        // LOD, Switch and the like select between their children so only batch the billboards within each child
+        traverseScope(nullptr, group);
+    }
+    else if (foldable(group))
+    {
+        if (group.getStateSet()) stateSets.push_back(group.getStateSet());
+        traverse(group);
+        if (group.getStateSet()) stateSets.pop_back();
+    }
+    else
+    {
+        traverseScope(&group, group);
+    }
+}
+
+void BatchOsgBillboards::apply(osg::Transform& transform)
+{
+    if ((!transform.asMatrixTransform() && !transform.asPositionAttitudeTransform()) || transform.getReferenceFrame() != osg::Transform::RELATIVE_RF)
+    {
+        traverseScope(nullptr, transform);
+    }
+    else if (foldable(transform))
+    {
+        osg::Matrix previousMatrix = matrix;
+        transform.computeLocalToWorldMatrix(matrix, this);
+
+        if (transform.getStateSet()) stateSets.push_back(transform.getStateSet());
+        traverse(transform);
+        if (transform.getStateSet()) stateSets.pop_back();
+
+        matrix = previousMatrix;
+    }
+    else
+    {
+        traverseScope(&transform, transform);
+    }
+}
+
+void BatchOsgBillboards::apply(osg::Billboard& billboard)
+{
+    if (!scope || _nodePath.size() < 2) return;
+    if (billboard.getUpdateCallback() || billboard.getEventCallback() || billboard.getCullCallback()) return;
+
+    // the drawables keep their orientation and size, so only transforms that translate them can be folded into their positions
+    const double epsilon = 1e-6;
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            double expected = (r == c) ? 1.0 : 0.0;
+            if (std::abs(matrix(r, c) - expected) > epsilon) return;
+        }
+    }
+
+    osg::Group* parent = _nodePath[_nodePath.size() - 2]->asGroup();
+    if (!parent) return;
+
+    auto& gathered = scopes[scopeIndices[scope]];
+    gathered.billboards.emplace_back(parent, &billboard);
+
+    unsigned int numPositions = std::min(static_cast<unsigned int>(billboard.getPositionList().size()), billboard.getNumDrawables());
+    for (unsigned int i = 0; i < numPositions; ++i)
+    {
+        Key key(stateSets, billboard.getDrawable(i), billboard.getStateSet(), billboard.getNodeMask(), billboard.getMode(), billboard.getAxis(), billboard.getNormal());
+        auto [itr, inserted] = gathered.positionIndices.emplace(key, gathered.positions.size());
+        if (inserted) gathered.positions.emplace_back(key, std::vector<osg::Vec3>());
+        gathered.positions[itr->second].second.push_back(billboard.getPosition(i) * matrix);
+    }
+}
+
+namespace
+{
+    // split positions at the median along the longest axis until each cluster is within the count and extent limits
+    void clusterPositions(std::vector<osg::Vec3>& positions, size_t begin, size_t end, size_t maxPositions, double maxExtent, std::vector<std::pair<size_t, size_t>>& clusters)
+    {
+        osg::BoundingBox bb;
+        for (size_t i = begin; i < end; ++i) bb.expandBy(positions[i]);
+
+        size_t numPositions = end - begin;
+        osg::Vec3 extent = bb._max - bb._min;
+        int axis = (extent.x() >= extent.y() && extent.x() >= extent.z()) ? 0 : (extent.y() >= extent.z() ? 1 : 2);
+
+        // coincident positions can't be separated so leave them in one cluster
+        if ((numPositions <= maxPositions && (maxExtent <= 0.0 || extent[axis] <= maxExtent)) || numPositions < 2 || extent[axis] <= 0.0f)
+        {
+            clusters.emplace_back(begin, end);
+            return;
+        }
+
+        size_t middle = begin + numPositions / 2;
+        std::nth_element(positions.begin() + begin, positions.begin() + middle, positions.begin() + end,
+                         [&](const osg::Vec3& lhs, const osg::Vec3& rhs) { return lhs[axis] < rhs[axis]; });
+
+        clusterPositions(positions, begin, middle, maxPositions, maxExtent, clusters);
+        clusterPositions(positions, middle, end, maxPositions, maxExtent, clusters);
+    }
+} // namespace
+
+size_t BatchOsgBillboards::batch(ConversionStatistics* statistics)
+{
+    size_t numBatchedBillboards = 0;
+    size_t numBatches = 0;
+
+    for (auto& gathered : scopes)
+    {
+        auto& scopeGroup = gathered.group;
+
+        // nothing to gain from rebuilding a lone billboard
+        if (gathered.billboards.size() < 2) continue;
+
+        for (auto& [parent, billboard] : gathered.billboards)
+        {
+            parent->removeChild(billboard.get());
+
+            // remove the transforms and groups left empty, these only have the one parent so aren't used elsewhere
+            osg::ref_ptr<osg::Group> group = parent;
+            while (group != scopeGroup && group->getNumChildren() == 0 && group->getNumParents() == 1)
+            {
+                osg::ref_ptr<osg::Group> groupParent = group->getParent(0);
+                groupParent->removeChild(group.get());
+                group = groupParent;
+            }
+        }
+        numBatchedBillboards += gathered.billboards.size();
+
+        // recreate the state inherited from the nodes that were between the scope and the billboards
+        std::map<StateSets, osg::ref_ptr<osg::Group>> stateGroups;
+
+        for (auto& [key, positions] : gathered.positions)
+        {
+            auto& [keyStateSets, drawable, stateset, nodeMask, mode, axis, normal] = key;
+
+            auto& stateGroup = stateGroups[keyStateSets];
+            if (!stateGroup)
+            {
+                osg::ref_ptr<osg::Group> group = scopeGroup;
+                for (auto& keyStateSet : keyStateSets)
+                {
+                    osg::ref_ptr<osg::Group> child = new osg::Group;
+                    child->setStateSet(keyStateSet);
+                    group->addChild(child);
+                    group = child;
+                }
+                stateGroup = group;
+            }
+
+            std::vector<std::pair<size_t, size_t>> clusters;
+            clusterPositions(positions, 0, positions.size(), std::max(maxBillboardsPerBatch, 1u), maxBatchExtent, clusters);
+
+            for (auto& [begin, end] : clusters)
+            {
+                osg::ref_ptr<osg::Billboard> new_billboard = new osg::Billboard;
+                new_billboard->setStateSet(stateset);
+                new_billboard->setNodeMask(nodeMask);
+                new_billboard->setMode(static_cast<osg::Billboard::Mode>(mode));
+                new_billboard->setAxis(axis);
+                new_billboard->setNormal(normal);
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    new_billboard->addDrawable(drawable, positions[i]);
+                }
+
+                stateGroup->addChild(new_billboard);
+            }
+            numBatches += clusters.size();
+        }
+    }
+
+    if (statistics)
+    {
+        statistics->numBatchedBillboards += numBatchedBillboards;
+        statistics->numBillboardBatches += numBatches;
+    }
+
+    scopes.clear();
+    scopeIndices.clear();
+
+    return numBatches;
+}
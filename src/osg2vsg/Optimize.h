@@ -7,6 +7,7 @@
 
 namespace osg2vsg
 {
+    struct ConversionStatistics;
 
     class OptimizeOsgBillboards : public osg::NodeVisitor
     {
@@ -29,4 +30,47 @@ namespace osg2vsg
 
         void optimize();
     };
+
+    /// gather the billboards sharing a drawable and state from across the scene, folding in the translations of the transforms above them,
+    /// and replace them with spatially clustered billboards that each convert to one instanced draw with its own cull bound.
+    /// Billboards are only gathered within the subgraphs of plain groups and transforms, so the children of LOD, Switch and other nodes are batched separately.
+    class BatchOsgBillboards : public osg::NodeVisitor
+    {
+    public:
+        BatchOsgBillboards(uint32_t in_maxBillboardsPerBatch = 1024, double in_maxBatchExtent = 0.0);
+
+        uint32_t maxBillboardsPerBatch; // most positions in a batched billboard
+        double maxBatchExtent;          // largest extent of the positions of a batched billboard along any axis, 0 for no limit
+
+        void apply(osg::Group& group) override;
+        void apply(osg::Transform& transform) override;
+        void apply(osg::Billboard& billboard) override;
+
+        /// replace the gathered billboards with the batched ones, returning the number of batched billboards created.
+        size_t batch(ConversionStatistics* statistics = nullptr);
+
+    protected:
+        using StateSets = std::vector<osg::StateSet*>;
+        using Key = std::tuple<StateSets, osg::Drawable*, osg::StateSet*, osg::Node::NodeMask, int, osg::Vec3, osg::Vec3>;
+        using Edge = std::pair<osg::ref_ptr<osg::Group>, osg::ref_ptr<osg::Billboard>>;
+
+        struct Scope
+        {
+            osg::ref_ptr<osg::Group> group;
+            std::vector<std::pair<Key, std::vector<osg::Vec3>>> positions; // in first seen order so the batched graph doesn't depend on allocation addresses
+            std::map<Key, size_t> positionIndices;
+            std::vector<Edge> billboards; // parent and billboard of each billboard gathered
+        };
+
+        /// group the billboards are batched under, along with the translation and state sets of the nodes between it and the current node
+        osg::Group* scope = nullptr;
+        osg::Matrix matrix;
+        StateSets stateSets;
+
+        std::vector<Scope> scopes; // in first seen order
+        std::map<osg::Group*, size_t> scopeIndices;
+
+        void traverseScope(osg::Group* newScope, osg::Node& node);
+        bool foldable(const osg::Node& node) const;
+    };
 } // namespace osg2vsg
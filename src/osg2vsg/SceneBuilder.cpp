@@ -12,6 +12,7 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 
 #include "SceneBuilder.h"
 
+#include "BoundingSphere.h"
 #include "GeometryUtils.h"
 #include "ImageUtils.h"
 #include "Optimize.h"
@@ -87,7 +88,10 @@ SceneBuilderBase::StatePair SceneBuilderBase::computeStatePair(osg::StateSet* st
 
 SceneBuilderBase::StatePair& SceneBuilderBase::getStatePair()
 {
-    auto& statepair = stateMap[statestack];
+    auto& shared = caches();
+    std::lock_guard<std::mutex> guard(shared.cacheMutex);
+
+    auto& statepair = shared.stateMap[statestack];
 
     if (!statestack.empty() && (!statepair.first || !statepair.second))
     {
@@ -105,14 +109,18 @@ SceneBuilderBase::StatePair& SceneBuilderBase::getStatePair()
             }
         }
 
-        statepair = computeStatePair(combined);
+        statepair = shared.computeStatePair(combined);
     }
     return statepair;
 }
 
 vsg::ref_ptr<vsg::DescriptorImage> SceneBuilderBase::convertToVsgTexture(const osg::Texture* osgtexture)
 {
-    if (auto itr = texturesMap.find(osgtexture); itr != texturesMap.end()) return itr->second;
+    auto& shared = caches();
+    {
+        std::lock_guard<std::mutex> guard(shared.cacheMutex);
+        if (auto itr = shared.texturesMap.find(osgtexture); itr != shared.texturesMap.end()) return itr->second;
+    }
 
     const osg::Image* image = osgtexture ? osgtexture->getImage(0) : nullptr;
     auto textureData = convertToVsg(image, buildOptions->mapRGBtoRGBAHint);
@@ -125,9 +133,53 @@ vsg::ref_ptr<vsg::DescriptorImage> SceneBuilderBase::convertToVsgTexture(const o
     vsg::ref_ptr<vsg::Sampler> sampler = convertToSampler(osgtexture);
 
     auto texture = vsg::DescriptorImage::create(sampler, textureData, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    texturesMap[osgtexture] = texture;
 
-    return texture;
+    // another thread may have converted the same texture in the meantime, if so use its copy so all users share the one DescriptorImage
+    std::lock_guard<std::mutex> guard(shared.cacheMutex);
+    return shared.texturesMap.emplace(osgtexture, texture).first->second;
+}
+
+void SceneBuilderBase::collectTextures(const osg::StateSet* stateset, Textures& textures) const
+{
+    if (!stateset) return;
+
+    // only the texture units that createVsgStateSet() maps to descriptors
+    for (unsigned int unit : {DIFFUSE_TEXTURE_UNIT, OPACITY_TEXTURE_UNIT, AMBIENT_TEXTURE_UNIT, NORMAL_TEXTURE_UNIT, SPECULAR_TEXTURE_UNIT})
+    {
+        auto osgtex = dynamic_cast<const osg::Texture*>(stateset->getTextureAttribute(unit, osg::StateAttribute::TEXTURE));
+        if (osgtex && osgtex->getImage(0)) textures.insert(osgtex);
+    }
+}
+
+void SceneBuilderBase::collectTextures(osg::Node* scene, Textures& textures) const
+{
+    struct CollectTextures : public osg::NodeVisitor
+    {
+        const SceneBuilderBase& builder;
+        Textures& textures;
+
+        CollectTextures(const SceneBuilderBase& in_builder, Textures& in_textures) :
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+            builder(in_builder),
+            textures(in_textures) {}
+
+        void apply(osg::Node& node) override
+        {
+            builder.collectTextures(node.getStateSet(), textures);
+            traverse(node);
+        }
+    } collector(*this, textures);
+
+    if (scene) scene->accept(collector);
+}
+
+void SceneBuilderBase::convertTextures(const Textures& textures, TaskPool& taskPool)
+{
+    std::vector<const osg::Texture*> textureList(textures.begin(), textures.end());
+
+    taskPool.parallel_for(textureList.size(), [&](size_t i) {
+        convertToVsgTexture(textureList[i]);
+    });
 }
 
 vsg::ref_ptr<vsg::DescriptorSet> SceneBuilderBase::createVsgStateSet(vsg::ref_ptr<vsg::DescriptorSetLayout> descriptorSetLayout, const osg::StateSet* stateset, uint32_t shaderModeMask)
@@ -521,6 +573,57 @@ osg::ref_ptr<osg::Node> SceneBuilder::createOSG()
     return group;
 }
 
+vsg::ref_ptr<vsg::Command> SceneBuilder::getOrCreateLeaf(osg::Geometry* geometry, uint32_t requiredGeomAttributesMask)
+{
+    std::promise<vsg::ref_ptr<vsg::Command>> promise;
+    {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        if (auto itr = geometriesMap.find(geometry); itr != geometriesMap.end())
+        {
+            DEBUG_OUTPUT << "sharing geometry" << std::endl;
+            return itr->second;
+        }
+
+        // another thread is converting this geometry so wait for its result
+        if (auto itr = pendingGeometries.find(geometry); itr != pendingGeometries.end())
+        {
+            auto future = itr->second;
+            lock.unlock();
+            return future.get();
+        }
+
+        if (auto itr = firstGeometryMasks.find(geometry); itr != firstGeometryMasks.end()) requiredGeomAttributesMask = itr->second;
+
+        pendingGeometries[geometry] = promise.get_future().share();
+    }
+
+    vsg::ref_ptr<vsg::Command> leaf;
+    try
+    {
+        leaf = convertToVsg(geometry, requiredGeomAttributesMask, *buildOptions);
+    }
+    catch (...)
+    {
+        // release the threads waiting on this geometry and let later requests try again
+        {
+            std::lock_guard<std::mutex> guard(cacheMutex);
+            pendingGeometries.erase(geometry);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(cacheMutex);
+        if (leaf) geometriesMap[geometry] = leaf;
+        pendingGeometries.erase(geometry);
+    }
+
+    promise.set_value(leaf);
+
+    return leaf;
+}
+
 vsg::ref_ptr<vsg::Node> SceneBuilder::createTransformGeometryGraphVSG(TransformGeometryMap& transformGeometryMap, vsg::Paths& /*searchPaths*/, uint32_t requiredGeomAttributesMask)
 {
     DEBUG_OUTPUT << "createTransformGeometryGraphVSG() " << transformGeometryMap.size() << std::endl;
@@ -565,6 +668,18 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createTransformGeometryGraphVSG(TransformG
                 vsg::dvec3 bb_max(overall_bb.xMax(), overall_bb.yMax(), overall_bb.zMax());
                 vsg::dsphere boundingSphere((bb_min + bb_max) * 0.5, vsg::length(bb_max - bb_min) * 0.5);
 
+                // the converted leaves are cached so collecting their vertices now doesn't convert them twice
+                if (buildOptions->tightBounds)
+                {
+                    CollectVertices collectVertices;
+                    collectVertices.matrixStack.back() = vsgmatrix;
+                    for (auto& geometry : geometries)
+                    {
+                        if (auto leaf = getOrCreateLeaf(geometry, requiredGeomAttributesMask)) leaf->accept(collectVertices);
+                    }
+                    boundingSphere = computeTightBound(collectVertices, boundingSphere, buildOptions->statistics.get());
+                }
+
                 if (buildOptions->insertCullNodes)
                 {
                     group->addChild(vsg::CullNode::create(boundingSphere, transform));
@@ -621,24 +736,52 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createTransformGeometryGraphVSG(TransformG
         }
 #endif
 
-        for (auto& geometry : geometries)
+        // draw all the geometries under this transform from shared buffers with a single indirect draw, culled as one using their combined bounds
+        if (buildOptions->geometryTarget == VSG_DRAWINDEXEDINDIRECT)
         {
-#if 1
-            vsg::ref_ptr<vsg::Command> leaf;
-            if (geometriesMap.find(geometry) != geometriesMap.end())
+            std::vector<vsg::ref_ptr<vsg::Command>> leaves;
+            osg::BoundingBox bb;
+            for (auto& geometry : geometries)
             {
-                DEBUG_OUTPUT << "sharing geometry" << std::endl;
-                leaf = geometriesMap[geometry];
+                if (auto leaf = getOrCreateLeaf(geometry, requiredGeomAttributesMask))
+                {
+                    leaves.push_back(leaf);
+                    bb.expandBy(geometry->getBoundingBox());
+                }
             }
-            else
+
+            auto draw = createDrawIndexedIndirect(leaves, buildOptions->statistics.get());
+            if (!draw) continue;
+
+            if (requiresLeafCullGroup)
             {
-                leaf = convertToVsg(geometry, requiredGeomAttributesMask, buildOptions->geometryTarget);
-                if (leaf)
+                vsg::dvec3 bb_min(bb.xMin(), bb.yMin(), bb.zMin());
+                vsg::dvec3 bb_max(bb.xMax(), bb.yMax(), bb.zMax());
+
+                vsg::dsphere boundingSphere((bb_min + bb_max) * 0.5, vsg::length(bb_max - bb_min) * 0.5);
+                if (buildOptions->tightBounds) boundingSphere = computeTightBound(*draw, boundingSphere, buildOptions->statistics.get());
+                if (buildOptions->insertCullNodes)
                 {
-                    geometriesMap[geometry] = leaf;
+                    localGroup->addChild(vsg::CullNode::create(boundingSphere, draw));
+                }
+                else
+                {
+                    auto cullGroup = vsg::CullGroup::create(boundingSphere);
+                    cullGroup->addChild(draw);
+                    localGroup->addChild(cullGroup);
                 }
             }
+            else
+            {
+                localGroup->addChild(draw);
+            }
+            continue;
+        }
 
+        for (auto& geometry : geometries)
+        {
+#if 1
+            vsg::ref_ptr<vsg::Command> leaf = getOrCreateLeaf(geometry, requiredGeomAttributesMask);
             if (!leaf) continue;
 
             if (requiresLeafCullGroup)
@@ -648,6 +791,7 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createTransformGeometryGraphVSG(TransformG
                 vsg::dvec3 bb_max(bb.xMax(), bb.yMax(), bb.zMax());
 
                 vsg::dsphere boundingSphere((bb_min + bb_max) * 0.5, vsg::length(bb_max - bb_min) * 0.5);
+                if (buildOptions->tightBounds) boundingSphere = computeTightBound(*leaf, boundingSphere, buildOptions->statistics.get());
                 if (buildOptions->insertCullNodes)
                 {
                     DEBUG_OUTPUT << "Using CullNode" << std::endl;
@@ -723,7 +867,22 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createVSG(vsg::Paths& searchPaths)
     vsg::ref_ptr<vsg::Group> transparentGroup = vsg::Group::create();
     group->addChild(transparentGroup);
 
-    for (auto [masks, transformStatePair] : masksTransformStateMap)
+    // each (masks, stateset) bucket is built independently, possibly in parallel, then merged into its pipeline group in the original order
+    struct Bucket
+    {
+        vsg::ref_ptr<vsg::StateGroup> graphicsPipelineGroup;
+        vsg::ref_ptr<vsg::GraphicsPipeline> graphicsPipeline;
+        uint32_t shaderModeMask;
+        uint32_t geometrymask;
+        osg::ref_ptr<osg::StateSet> stateset;
+        TransformGeometryMap* transformGeometryMap;
+        vsg::ref_ptr<vsg::Node> subgraph;
+    };
+
+    std::vector<Bucket> buckets;
+    firstGeometryMasks.clear();
+
+    for (auto& [masks, transformStatePair] : masksTransformStateMap)
     {
         unsigned int maxNumDescriptors = transformStatePair.stateTransformMap.size();
         if (maxNumDescriptors == 0)
@@ -737,6 +896,8 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createVSG(vsg::Paths& searchPaths)
         }
 
         uint32_t geometrymask = (masks.second | buildOptions->overrideGeomAttributes) & buildOptions->supportedGeometryAttributes;
+        if (buildOptions->interleavedArrays) geometrymask |= INTERLEAVED;
+        if (buildOptions->quantizeArrays) geometrymask |= QUANTIZED;
         uint32_t shaderModeMask = (masks.first | buildOptions->overrideShaderModeMask) & buildOptions->supportedShaderModeMask;
         if (shaderModeMask & NORMAL_MAP) geometrymask |= TANGENT; // mesh probably won't have tangents so force them on if we want Normal mapping
 
@@ -749,9 +910,6 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createVSG(vsg::Paths& searchPaths)
 
         graphicsPipelineGroup->add(bindGraphicsPipeline);
 
-        auto graphicsPipeline = bindGraphicsPipeline->pipeline;
-        auto& descriptorSetLayouts = graphicsPipeline->layout->setLayouts;
-
         // attach based on use of transparency
         if (shaderModeMask & BLEND)
         {
@@ -762,34 +920,75 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createVSG(vsg::Paths& searchPaths)
             opaqueGroup->addChild(graphicsPipelineGroup);
         }
 
-        for (auto [stateset, transformeGeometryMap] : transformStatePair.stateTransformMap)
+        for (auto& [stateset, transformeGeometryMap] : transformStatePair.stateTransformMap)
         {
-            vsg::ref_ptr<vsg::Node> transformGeometryGraph = createTransformGeometryGraphVSG(transformeGeometryMap, searchPaths, geometrymask);
-            if (!transformGeometryGraph) continue;
+            buckets.push_back(Bucket{graphicsPipelineGroup, bindGraphicsPipeline->pipeline, shaderModeMask, geometrymask, stateset, &transformeGeometryMap, {}});
 
-            vsg::ref_ptr<vsg::DescriptorSet> descriptorSet = createVsgStateSet(descriptorSetLayouts.front(), stateset, shaderModeMask);
-            if (descriptorSet)
+            // record the mask of the first bucket each geometry appears in so shared geometries are converted the same way whatever order buckets complete in,
+            // and compute the bounds now as osg computes them lazily which isn't safe to do from multiple threads.
+            for (auto& [matrix, geometries] : transformeGeometryMap)
             {
-                auto stategroup = vsg::StateGroup::create();
-                graphicsPipelineGroup->addChild(stategroup);
-                stategroup->addChild(transformGeometryGraph);
-
-                if (buildOptions->useBindDescriptorSet)
-                {
-                    auto bindDescriptorSet = vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline->layout, 0, descriptorSet);
-                    stategroup->add(bindDescriptorSet);
-                }
-                else
+                for (auto& geometry : geometries)
                 {
-                    auto bindDescriptorSets = vsg::BindDescriptorSets::create(VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline->layout, 0, vsg::DescriptorSets{descriptorSet});
-                    stategroup->add(bindDescriptorSets);
+                    firstGeometryMasks.emplace(geometry.get(), geometrymask);
+                    geometry->getBoundingBox();
                 }
             }
+        }
+    }
+
+    auto buildBucket = [&](size_t i) {
+        auto& bucket = buckets[i];
+
+        vsg::ref_ptr<vsg::Node> transformGeometryGraph = createTransformGeometryGraphVSG(*bucket.transformGeometryMap, searchPaths, bucket.geometrymask);
+        if (!transformGeometryGraph) return;
+
+        auto& descriptorSetLayouts = bucket.graphicsPipeline->layout->setLayouts;
+        vsg::ref_ptr<vsg::DescriptorSet> descriptorSet = createVsgStateSet(descriptorSetLayouts.front(), bucket.stateset, bucket.shaderModeMask);
+        if (descriptorSet)
+        {
+            auto stategroup = vsg::StateGroup::create();
+            stategroup->addChild(transformGeometryGraph);
+
+            if (buildOptions->useBindDescriptorSet)
+            {
+                auto bindDescriptorSet = vsg::BindDescriptorSet::create(VK_PIPELINE_BIND_POINT_GRAPHICS, bucket.graphicsPipeline->layout, 0, descriptorSet);
+                stategroup->add(bindDescriptorSet);
+            }
             else
             {
-                graphicsPipelineGroup->addChild(transformGeometryGraph);
+                auto bindDescriptorSets = vsg::BindDescriptorSets::create(VK_PIPELINE_BIND_POINT_GRAPHICS, bucket.graphicsPipeline->layout, 0, vsg::DescriptorSets{descriptorSet});
+                stategroup->add(bindDescriptorSets);
             }
+
+            bucket.subgraph = stategroup;
+        }
+        else
+        {
+            bucket.subgraph = transformGeometryGraph;
         }
+    };
+
+    auto taskPool = buildOptions->taskPool;
+    if (!taskPool && buildOptions->parallelConversion) taskPool = TaskPool::create(buildOptions->numThreads);
+
+    if (taskPool)
+    {
+        Textures textures;
+        for (auto& bucket : buckets) collectTextures(bucket.stateset.get(), textures);
+        convertTextures(textures, *taskPool);
+
+        taskPool->parallel_for(buckets.size(), buildBucket);
+    }
+    else
+    {
+        for (size_t i = 0; i < buckets.size(); ++i) buildBucket(i);
+    }
+
+    // merge the bucket subgraphs
+    for (auto& bucket : buckets)
+    {
+        if (bucket.subgraph) bucket.graphicsPipelineGroup->addChild(bucket.subgraph);
     }
 
     // if we are using CullGroups then place one at the top of the created scene graph
@@ -799,6 +998,7 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::createVSG(vsg::Paths& searchPaths)
         group->accept(computeBounds);
 
         vsg::dsphere boundingSphere((computeBounds.bounds.min + computeBounds.bounds.max) * 0.5, vsg::length(computeBounds.bounds.max - computeBounds.bounds.min) * 0.5);
+        if (buildOptions->tightBounds) boundingSphere = computeTightBound(*group, boundingSphere, buildOptions->statistics.get());
         auto cullGroup = vsg::CullGroup::create(boundingSphere);
 
         // add the groups children to the cullGroup
@@ -837,6 +1037,13 @@ vsg::ref_ptr<vsg::Node> SceneBuilder::optimizeAndConvertToVsg(osg::ref_ptr<osg::
         OptimizeOsgBillboards optimizeBillboards;
         osg_scene->accept(optimizeBillboards);
         optimizeBillboards.optimize();
+
+        if (buildOptions->batchBillboards)
+        {
+            BatchOsgBillboards batchBillboards(buildOptions->maxBillboardsPerBatch, buildOptions->maxBillboardBatchExtent);
+            osg_scene->accept(batchBillboards);
+            batchBillboards.batch(buildOptions->statistics.get());
+        }
     }
 
     osg_scene->accept(*this);
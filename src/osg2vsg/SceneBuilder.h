@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <future>
 #include <iostream>
 
 #include <osg/Billboard>
@@ -51,6 +52,13 @@ namespace osg2vsg
         TexturesMap texturesMap;
         bool writeToFileProgramAndDataSetSets = false;
 
+        // when converting in parallel each task has its own builder that uses the stateMap, uniqueStateSets and texturesMap of the cacheOwner,
+        // access to these caches is serialized by the cacheOwner's cacheMutex.
+        SceneBuilderBase* cacheOwner = nullptr;
+        std::mutex cacheMutex;
+
+        SceneBuilderBase& caches() { return cacheOwner ? *cacheOwner : *this; }
+
         osg::ref_ptr<osg::StateSet> uniqueState(osg::ref_ptr<osg::StateSet> stateset, bool programStateSet);
 
         StatePair computeStatePair(osg::StateSet* stateset);
@@ -59,6 +67,12 @@ namespace osg2vsg
         // core VSG style usage
         vsg::ref_ptr<vsg::DescriptorImage> convertToVsgTexture(const osg::Texture* osgtexture);
 
+        // texture pre-pass, converts the textures used by the shaders up front so the geometry traversal only needs to look them up in texturesMap
+        using Textures = std::set<const osg::Texture*>;
+        void collectTextures(const osg::StateSet* stateset, Textures& textures) const;
+        void collectTextures(osg::Node* scene, Textures& textures) const;
+        void convertTextures(const Textures& textures, TaskPool& taskPool);
+
         vsg::ref_ptr<vsg::DescriptorSet> createVsgStateSet(vsg::ref_ptr<vsg::DescriptorSetLayout> descriptorSetLayout, const osg::StateSet* stateset, uint32_t shaderModeMask);
     };
 
@@ -93,6 +107,14 @@ namespace osg2vsg
         MasksTransformStateMap masksTransformStateMap;
         GeometriesMap geometriesMap;
 
+        // parallel leaf generation support, geometries shared between buckets are converted once with the attributes mask of the first bucket they appear in.
+        using PendingGeometriesMap = std::map<const osg::Geometry*, std::shared_future<vsg::ref_ptr<vsg::Command>>>;
+        using GeometryMaskMap = std::map<const osg::Geometry*, uint32_t>;
+        PendingGeometriesMap pendingGeometries;
+        GeometryMaskMap firstGeometryMasks;
+
+        vsg::ref_ptr<vsg::Command> getOrCreateLeaf(osg::Geometry* geometry, uint32_t requiredGeomAttributesMask);
+
         osg::ref_ptr<osg::Node> createStateGeometryGraphOSG(StateGeometryMap& stateGeometryMap);
         osg::ref_ptr<osg::Node> createTransformGeometryGraphOSG(TransformGeometryMap& transformGeometryMap);
         osg::ref_ptr<osg::Node> createOSG();
@@ -14,10 +14,23 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include "GeometryUtils.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
+#include <thread>
 
 using namespace osg2vsg;
 
+#ifdef OSG2VSG_PRECOMPILED_SHADERS
+namespace osg2vsg
+{
+    // generated by precompile_shaders.cpp, sorted by key
+    extern const PrecompiledSPIRV precompiledSPIRV[];
+    extern const size_t numPrecompiledSPIRV;
+} // namespace osg2vsg
+#endif
+
 uint32_t osg2vsg::calculateShaderModeMask(const osg::StateSet* stateSet)
 {
     uint32_t stateMask = 0;
@@ -75,6 +88,150 @@ std::set<std::string> osg2vsg::createPSCDefineStrings(const uint32_t& shaderMode
     if (shaderModeMask & BILLBOARD) defines.insert("VSG_BILLBOARD");
 
     if (shaderModeMask & SHADER_TRANSLATE) defines.insert("VSG_TRANSLATE");
+    if (geometryAttrbutes & INSTANCE_MATRIX) defines.insert("VSG_INSTANCE_MATRIX");
+
+    if ((geometryAttrbutes & QUANTIZED) && (hasnormal || hastangent)) defines.insert("VSG_OCTAHEDRAL");
 
     return defines;
 }
+
+uint64_t osg2vsg::computeShaderHash(const vsg::ShaderStage& stage)
+{
+    static const std::set<std::string> s_noDefines;
+    auto& module = stage.module;
+    return computeShaderHash(stage, (module && module->hints) ? module->hints->defines : s_noDefines);
+}
+
+uint64_t osg2vsg::computeShaderHash(const vsg::ShaderStage& stage, const std::set<std::string>& defines)
+{
+    // FNV-1a, std::hash<> isn't guaranteed to be the same between runs or builds so can't be used for a persistent cache.
+    uint64_t hash = 14695981039346656037ull;
+    auto combine = [&hash](const void* data, size_t size) {
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    auto combineString = [&combine](const std::string& str) {
+        combine(str.data(), str.size());
+        combine("", 1); // separator so adjacent strings can't alias
+    };
+
+    uint32_t stageFlags = stage.stage;
+    combine(&stageFlags, sizeof(stageFlags));
+    combineString(stage.entryPointName);
+
+    if (auto& module = stage.module)
+    {
+        combineString(module->source);
+        if (auto& hints = module->hints)
+        {
+            combine(&hints->vulkanVersion, sizeof(hints->vulkanVersion));
+            uint8_t generateDebugInfo = hints->generateDebugInfo ? 1 : 0;
+            combine(&generateDebugInfo, sizeof(generateDebugInfo));
+        }
+        for (auto& define : defines) combineString(define);
+    }
+
+    return hash;
+}
+
+std::set<std::string> osg2vsg::filterImportedDefines(const std::string& source, const std::set<std::string>& defines)
+{
+    auto pragma = source.find("#pragma import_defines");
+    if (pragma == std::string::npos) return defines;
+
+    auto start = source.find('(', pragma);
+    auto end = source.find(')', pragma);
+    if (start == std::string::npos || end == std::string::npos || end < start) return defines;
+
+    std::set<std::string> imported;
+    std::string token;
+    for (auto c : source.substr(start + 1, end - start - 1))
+    {
+        if (c == ',' || std::isspace(static_cast<unsigned char>(c)))
+        {
+            if (defines.count(token) > 0) imported.insert(token);
+            token.clear();
+        }
+        else
+        {
+            token.push_back(c);
+        }
+    }
+    if (defines.count(token) > 0) imported.insert(token);
+
+    return imported;
+}
+
+bool osg2vsg::assignPrecompiledSPIRV(vsg::ShaderStage& stage)
+{
+    auto& module = stage.module;
+    if (!module) return false;
+    if (!module->code.empty()) return true;
+
+#ifdef OSG2VSG_PRECOMPILED_SHADERS
+    if (module->source.empty() || !module->hints) return false;
+
+    auto key = computeShaderHash(stage, filterImportedDefines(module->source, module->hints->defines));
+
+    auto end = precompiledSPIRV + numPrecompiledSPIRV;
+    auto itr = std::lower_bound(precompiledSPIRV, end, key, [](const PrecompiledSPIRV& entry, uint64_t value) { return entry.key < value; });
+    if (itr == end || itr->key != key) return false;
+
+    module->code.assign(itr->code, itr->code + itr->size);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool osg2vsg::readOrCompileSPIRV(vsg::ShaderStage& stage, vsg::ref_ptr<const vsg::Options> options)
+{
+    auto& module = stage.module;
+    if (!module) return false;
+    if (!module->code.empty()) return true;
+    if (module->source.empty() || !options || !options->fileCache) return false;
+
+    auto cacheDirectory = options->fileCache / "osg2vsg";
+    auto filename = cacheDirectory / vsg::make_string(std::hex, std::setw(16), std::setfill('0'), computeShaderHash(stage), ".spv");
+
+    if (vsg::fileExists(filename))
+    {
+        std::ifstream fin(filename, std::ios::in | std::ios::binary | std::ios::ate);
+        auto size = static_cast<size_t>(fin.tellg());
+        if (fin && size > 0 && (size % sizeof(uint32_t)) == 0)
+        {
+            vsg::ShaderModule::SPIRV code(size / sizeof(uint32_t));
+            fin.seekg(0);
+            fin.read(reinterpret_cast<char*>(code.data()), size);
+            if (fin)
+            {
+                module->code.swap(code);
+                return true;
+            }
+        }
+        vsg::warn("osg2vsg::readOrCompileSPIRV() unable to read ", filename, ", recompiling.");
+    }
+
+    auto shaderCompiler = vsg::ShaderCompiler::create();
+    if (!shaderCompiler->supported() || !shaderCompiler->compile(vsg::ref_ptr<vsg::ShaderStage>(&stage), {}, options) || module->code.empty()) return false;
+
+    // write to a temporary file and rename it into place so concurrent readers and writers never see a partially written file
+    vsg::makeDirectory(cacheDirectory);
+    auto tempFilename = vsg::Path(filename.string() + vsg::make_string(".", std::this_thread::get_id(), ".tmp"));
+    {
+        std::ofstream fout(tempFilename, std::ios::out | std::ios::binary);
+        fout.write(reinterpret_cast<const char*>(module->code.data()), module->code.size() * sizeof(uint32_t));
+        if (!fout)
+        {
+            vsg::warn("osg2vsg::readOrCompileSPIRV() unable to write ", tempFilename);
+            return true;
+        }
+    }
+    if (std::rename(tempFilename.string().c_str(), filename.string().c_str()) != 0) std::remove(tempFilename.string().c_str());
+
+    return true;
+}
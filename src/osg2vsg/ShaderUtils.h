@@ -41,4 +41,28 @@ namespace osg2vsg
 
     std::set<std::string> createPSCDefineStrings(const uint32_t& shaderModeMask, const uint32_t& geometryAttrbutes);
 
+    // compute a hash of the shader stage's source and compile settings that is stable between runs, used to key the on disk SPIR-V cache.
+    uint64_t computeShaderHash(const vsg::ShaderStage& stage);
+
+    // compute a hash as above but using the specified defines in place of the stage's hints->defines.
+    uint64_t computeShaderHash(const vsg::ShaderStage& stage, const std::set<std::string>& defines);
+
+    // return the subset of defines listed in the source's #pragma import_defines, the others don't affect the compiled SPIR-V.
+    std::set<std::string> filterImportedDefines(const std::string& source, const std::set<std::string>& defines);
+
+    // SPIR-V of a built-in shader permutation compiled at build time by precompile_shaders.cpp, key is computeShaderHash() using the imported defines.
+    struct PrecompiledSPIRV
+    {
+        uint64_t key;
+        const uint32_t* code;
+        size_t size;
+    };
+
+    // assign the stage's SPIR-V from the table of shaders precompiled at build time, returns false if the library was built without OSG2VSG_PRECOMPILE_SHADERS or the permutation isn't in the table.
+    bool assignPrecompiledSPIRV(vsg::ShaderStage& stage);
+
+    // assign the stage's SPIR-V from the options->fileCache, compiling and writing it to the fileCache when not already present.
+    // returns true if stage.module->code is assigned, false if there is no fileCache or the shader could not be compiled.
+    bool readOrCompileSPIRV(vsg::ShaderStage& stage, vsg::ref_ptr<const vsg::Options> options);
+
 } // namespace osg2vsg
@@ -0,0 +1,210 @@
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include "TaskPool.h"
+
+using namespace osg2vsg;
+
+namespace
+{
+    // the pool and worker index of the current thread, used to push new tasks onto the calling worker's own deque.
+    thread_local const TaskPool* s_currentPool = nullptr;
+    thread_local size_t s_currentWorker = 0;
+} // namespace
+
+TaskPool::TaskPool(uint32_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        workers.emplace_back(new Worker);
+    }
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i]->thread = std::thread([this, i]() { workerLoop(i); });
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+        active = false;
+    }
+    wakeUp.notify_all();
+
+    for (auto& worker : workers)
+    {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+void TaskPool::run(TaskGroup& group, Task task)
+{
+    {
+        std::lock_guard<std::mutex> guard(group.mutex);
+        ++group.pending;
+    }
+
+    Entry entry{&group, std::move(task)};
+
+    // no worker threads available so just run the task directly
+    if (workers.empty())
+    {
+        execute(entry);
+        return;
+    }
+
+    size_t index = (s_currentPool == this) ? s_currentWorker : (nextWorker++ % workers.size());
+    {
+        auto& worker = *workers[index];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        worker.entries.push_back(std::move(entry));
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+        ++numQueued;
+    }
+    wakeUp.notify_one();
+}
+
+void TaskPool::wait(TaskGroup& group)
+{
+    size_t preferred = (s_currentPool == this) ? s_currentWorker : 0;
+
+    Entry entry;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> guard(group.mutex);
+            if (group.pending == 0) break;
+        }
+
+        if (takeFromGroup(preferred, group, entry))
+        {
+            execute(entry);
+            continue;
+        }
+
+        // all the outstanding tasks are running on other threads so wait for them to complete
+        std::unique_lock<std::mutex> lock(group.mutex);
+        group.completed.wait(lock, [&group]() { return group.pending == 0; });
+        break;
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> guard(group.mutex);
+        std::swap(exception, group.exception);
+    }
+    if (exception) std::rethrow_exception(exception);
+}
+
+bool TaskPool::takeAny(size_t preferred, Entry& entry)
+{
+    if (workers.empty()) return false;
+
+    // own deque first, taking the most recently added task
+    {
+        auto& worker = *workers[preferred];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        if (!worker.entries.empty())
+        {
+            entry = std::move(worker.entries.back());
+            worker.entries.pop_back();
+            --numQueued;
+            return true;
+        }
+    }
+
+    // steal the oldest task from the other workers
+    for (size_t i = 1; i < workers.size(); ++i)
+    {
+        auto& worker = *workers[(preferred + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        if (!worker.entries.empty())
+        {
+            entry = std::move(worker.entries.front());
+            worker.entries.pop_front();
+            --numQueued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TaskPool::takeFromGroup(size_t preferred, TaskGroup& group, Entry& entry)
+{
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        auto& worker = *workers[(preferred + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        for (auto itr = worker.entries.rbegin(); itr != worker.entries.rend(); ++itr)
+        {
+            if (itr->group == &group)
+            {
+                entry = std::move(*itr);
+                worker.entries.erase(std::next(itr).base());
+                --numQueued;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskPool::execute(Entry& entry)
+{
+    // exceptions are passed on to the thread waiting on the group, so a throwing task can neither leave wait() blocked nor terminate a worker thread
+    std::exception_ptr exception;
+    try
+    {
+        entry.task();
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+    entry.task = nullptr;
+
+    auto& group = *entry.group;
+    std::lock_guard<std::mutex> guard(group.mutex);
+    if (exception && !group.exception) group.exception = exception;
+    if (--group.pending == 0) group.completed.notify_all();
+}
+
+void TaskPool::workerLoop(size_t index)
+{
+    s_currentPool = this;
+    s_currentWorker = index;
+
+    Entry entry;
+    while (active)
+    {
+        if (takeAny(index, entry))
+        {
+            execute(entry);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return !active || numQueued > 0; });
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+#include <vsg/all.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace osg2vsg
+{
+
+    /// Work-stealing thread pool used to run conversion tasks in parallel.
+    /// Each worker thread has its own deque of tasks, it pops its own work from the back and steals from the front of other workers' deques when idle.
+    class TaskPool : public vsg::Inherit<vsg::Object, TaskPool>
+    {
+    public:
+        /// create pool with numThreads worker threads, 0 selects std::thread::hardware_concurrency()-1 so the calling thread makes up the last core.
+        explicit TaskPool(uint32_t numThreads = 0);
+
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        using Task = std::function<void()>;
+
+        /// TaskGroup tracks the tasks submitted with it so that the submitting thread can wait for them to complete.
+        class TaskGroup
+        {
+        public:
+            TaskGroup() = default;
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+
+        protected:
+            friend class TaskPool;
+
+            std::mutex mutex;
+            std::condition_variable completed;
+            uint32_t pending = 0;
+            std::exception_ptr exception; // first exception thrown by the group's tasks, rethrown by wait()
+        };
+
+        /// add task to the pool, tracked by group.
+        void run(TaskGroup& group, Task task);
+
+        /// wait for all the tasks in group to complete, while waiting the calling thread runs the group's tasks that haven't yet been started.
+        /// Only the group's own tasks are run so that nested waits never depend on work further down the calling thread's stack.
+        /// Once all the tasks have completed the first exception thrown by any of them is rethrown.
+        void wait(TaskGroup& group);
+
+        /// call func(i) for i in [0, count), distributing the calls across the pool and the calling thread.
+        template<typename F>
+        void parallel_for(size_t count, F func)
+        {
+            if (count == 0) return;
+
+            TaskGroup group;
+            for (size_t i = 1; i < count; ++i)
+            {
+                run(group, [i, &func]() { func(i); });
+            }
+
+            // the tasks reference func so must complete before an exception from the calling thread's call leaves this scope
+            std::exception_ptr exception;
+            try
+            {
+                func(0);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+            wait(group);
+
+            if (exception) std::rethrow_exception(exception);
+        }
+
+        /// number of worker threads, excluding threads that call wait().
+        uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+    protected:
+        virtual ~TaskPool();
+
+        struct Entry
+        {
+            TaskGroup* group = nullptr;
+            Task task;
+        };
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Entry> entries;
+            std::thread thread;
+        };
+
+        bool takeAny(size_t preferred, Entry& entry);
+        bool takeFromGroup(size_t preferred, TaskGroup& group, Entry& entry);
+        void execute(Entry& entry);
+        void workerLoop(size_t index);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic_size_t nextWorker = 0;
+        std::atomic_size_t numQueued = 0;
+        std::atomic_bool active = true;
+
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+    };
+
+} // namespace osg2vsg
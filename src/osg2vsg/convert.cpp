@@ -24,20 +24,31 @@ vsg::ref_ptr<vsg::Data> osg2vsg::convert(const osg::Image& image, vsg::ref_ptr<c
     return convertToVsg(&image, mapRGBtoRGBAHint);
 }
 
-vsg::ref_ptr<vsg::Data> osg2vsg::convert(const osg::Array& src_array, vsg::ref_ptr<const vsg::Options> /*options*/)
+namespace
 {
+    template<class T>
+    vsg::ref_ptr<T> convertOrAdopt(const osg::Array& array, bool zeroCopy)
+    {
+        return zeroCopy ? adopt<T>(array) : convert<T>(array);
+    }
+} // namespace
+
+vsg::ref_ptr<vsg::Data> osg2vsg::convert(const osg::Array& src_array, vsg::ref_ptr<const vsg::Options> options)
+{
+    bool zeroCopy = vsg::value<bool>(false, OSG::zero_copy_arrays, options);
+
     switch (src_array.getType())
     {
     case (osg::Array::ByteArrayType): return {};
     case (osg::Array::ShortArrayType): return {};
     case (osg::Array::IntArrayType): return {};
 
-    case (osg::Array::UByteArrayType): return convert<vsg::ubyteArray>(src_array);
-    case (osg::Array::UShortArrayType): return convert<vsg::ushortArray>(src_array);
-    case (osg::Array::UIntArrayType): return convert<vsg::uintArray>(src_array);
+    case (osg::Array::UByteArrayType): return convertOrAdopt<vsg::ubyteArray>(src_array, zeroCopy);
+    case (osg::Array::UShortArrayType): return convertOrAdopt<vsg::ushortArray>(src_array, zeroCopy);
+    case (osg::Array::UIntArrayType): return convertOrAdopt<vsg::uintArray>(src_array, zeroCopy);
 
-    case (osg::Array::FloatArrayType): return convert<vsg::floatArray>(src_array);
-    case (osg::Array::DoubleArrayType): return convert<vsg::doubleArray>(src_array);
+    case (osg::Array::FloatArrayType): return convertOrAdopt<vsg::floatArray>(src_array, zeroCopy);
+    case (osg::Array::DoubleArrayType): return convertOrAdopt<vsg::doubleArray>(src_array, zeroCopy);
 
     case (osg::Array::Vec2bArrayType): return {};
     case (osg::Array::Vec3bArrayType): return {};
@@ -51,28 +62,28 @@ vsg::ref_ptr<vsg::Data> osg2vsg::convert(const osg::Array& src_array, vsg::ref_p
     case (osg::Array::Vec3iArrayType): return {};
     case (osg::Array::Vec4iArrayType): return {};
 
-    case (osg::Array::Vec2ubArrayType): return convert<vsg::ubvec2Array>(src_array);
-    case (osg::Array::Vec3ubArrayType): return convert<vsg::ubvec3Array>(src_array);
-    case (osg::Array::Vec4ubArrayType): return convert<vsg::ubvec4Array>(src_array);
+    case (osg::Array::Vec2ubArrayType): return convertOrAdopt<vsg::ubvec2Array>(src_array, zeroCopy);
+    case (osg::Array::Vec3ubArrayType): return convertOrAdopt<vsg::ubvec3Array>(src_array, zeroCopy);
+    case (osg::Array::Vec4ubArrayType): return convertOrAdopt<vsg::ubvec4Array>(src_array, zeroCopy);
 
-    case (osg::Array::Vec2usArrayType): return convert<vsg::usvec2Array>(src_array);
-    case (osg::Array::Vec3usArrayType): return convert<vsg::usvec3Array>(src_array);
-    case (osg::Array::Vec4usArrayType): return convert<vsg::usvec4Array>(src_array);
+    case (osg::Array::Vec2usArrayType): return convertOrAdopt<vsg::usvec2Array>(src_array, zeroCopy);
+    case (osg::Array::Vec3usArrayType): return convertOrAdopt<vsg::usvec3Array>(src_array, zeroCopy);
+    case (osg::Array::Vec4usArrayType): return convertOrAdopt<vsg::usvec4Array>(src_array, zeroCopy);
 
-    case (osg::Array::Vec2uiArrayType): return convert<vsg::uivec2Array>(src_array);
-    case (osg::Array::Vec3uiArrayType): return convert<vsg::usvec3Array>(src_array);
-    case (osg::Array::Vec4uiArrayType): return convert<vsg::usvec4Array>(src_array);
+    case (osg::Array::Vec2uiArrayType): return convertOrAdopt<vsg::uivec2Array>(src_array, zeroCopy);
+    case (osg::Array::Vec3uiArrayType): return convertOrAdopt<vsg::uivec3Array>(src_array, zeroCopy);
+    case (osg::Array::Vec4uiArrayType): return convertOrAdopt<vsg::uivec4Array>(src_array, zeroCopy);
 
-    case (osg::Array::Vec2ArrayType): return convert<vsg::vec2Array>(src_array);
-    case (osg::Array::Vec3ArrayType): return convert<vsg::vec3Array>(src_array);
-    case (osg::Array::Vec4ArrayType): return convert<vsg::vec4Array>(src_array);
+    case (osg::Array::Vec2ArrayType): return convertOrAdopt<vsg::vec2Array>(src_array, zeroCopy);
+    case (osg::Array::Vec3ArrayType): return convertOrAdopt<vsg::vec3Array>(src_array, zeroCopy);
+    case (osg::Array::Vec4ArrayType): return convertOrAdopt<vsg::vec4Array>(src_array, zeroCopy);
 
-    case (osg::Array::Vec2dArrayType): return convert<vsg::dvec2Array>(src_array);
-    case (osg::Array::Vec3dArrayType): return convert<vsg::dvec2Array>(src_array);
-    case (osg::Array::Vec4dArrayType): return convert<vsg::dvec2Array>(src_array);
+    case (osg::Array::Vec2dArrayType): return convertOrAdopt<vsg::dvec2Array>(src_array, zeroCopy);
+    case (osg::Array::Vec3dArrayType): return convertOrAdopt<vsg::dvec3Array>(src_array, zeroCopy);
+    case (osg::Array::Vec4dArrayType): return convertOrAdopt<vsg::dvec4Array>(src_array, zeroCopy);
 
-    case (osg::Array::MatrixArrayType): return convert<vsg::mat4Array>(src_array);
-    case (osg::Array::MatrixdArrayType): return convert<vsg::dmat4Array>(src_array);
+    case (osg::Array::MatrixArrayType): return convertOrAdopt<vsg::mat4Array>(src_array, zeroCopy);
+    case (osg::Array::MatrixdArrayType): return convertOrAdopt<vsg::dmat4Array>(src_array, zeroCopy);
 
 #if OSG_MIN_VERSION_REQUIRED(3, 5, 7)
     case (osg::Array::QuatArrayType): return {};
@@ -84,13 +95,36 @@ vsg::ref_ptr<vsg::Data> osg2vsg::convert(const osg::Array& src_array, vsg::ref_p
     }
 }
 
+namespace
+{
+    void reportStatistics(const osg2vsg::BuildOptions& buildOptions)
+    {
+        if (!buildOptions.statistics) return;
+
+        std::ostringstream str;
+        buildOptions.statistics->print(str);
+        vsg::debug("osg2vsg::convert() ", str.str());
+    }
+} // namespace
+
 vsg::ref_ptr<vsg::Node> osg2vsg::convert(const osg::Node& node, vsg::ref_ptr<const vsg::Options> options)
+{
+    return osg2vsg::convert(node, options, {});
+}
+
+vsg::ref_ptr<vsg::Node> osg2vsg::convert(const osg::Node& node, vsg::ref_ptr<const vsg::Options> options, vsg::ref_ptr<PipelineCache> pipelineCache, GetOrCreateTaskPool getOrCreateTaskPool)
 {
     bool mapRGBtoRGBAHint = !options || options->mapRGBtoRGBAHint;
     vsg::Paths searchPaths = options ? options->paths : vsg::getEnvPaths("VSG_FILE_PATH");
 
     vsg::ref_ptr<osg2vsg::BuildOptions> buildOptions;
-    auto pipelineCache = osg2vsg::PipelineCache::create();
+
+    // PipelineCache serializes access internally so it's safe to share the one assigned to the const options
+    if (auto optionsPipelineCache = options ? options->getObject<PipelineCache>(OSG::pipeline_cache) : nullptr)
+    {
+        pipelineCache = const_cast<PipelineCache*>(optionsPipelineCache);
+    }
+    if (!pipelineCache) pipelineCache = osg2vsg::PipelineCache::create();
 
     std::string build_options_filename;
     if (options->getValue(OSG::read_build_options, build_options_filename))
@@ -111,6 +145,42 @@ vsg::ref_ptr<vsg::Node> osg2vsg::convert(const osg::Node& node, vsg::ref_ptr<con
 
     buildOptions->options = options;
     buildOptions->pipelineCache = pipelineCache;
+    buildOptions->zeroCopyArrays = vsg::value<bool>(buildOptions->zeroCopyArrays, OSG::zero_copy_arrays, options);
+    buildOptions->collectStatistics = vsg::value<bool>(buildOptions->collectStatistics, OSG::collect_statistics, options);
+    if (buildOptions->collectStatistics && !buildOptions->statistics) buildOptions->statistics = osg2vsg::ConversionStatistics::create();
+    buildOptions->shareIdenticalData = vsg::value<bool>(buildOptions->shareIdenticalData, OSG::share_identical_data, options);
+    if (buildOptions->shareIdenticalData && !buildOptions->dataCache) buildOptions->dataCache = osg2vsg::DataCache::create();
+    if (!buildOptions->tangentCache) buildOptions->tangentCache = osg2vsg::TangentCache::create();
+
+    // TaskPool serializes access internally so it's safe to share the one assigned to the const options
+    auto taskPool = buildOptions->taskPool;
+    if (auto optionsTaskPool = options ? options->getObject<TaskPool>(OSG::task_pool) : nullptr; optionsTaskPool && !taskPool)
+    {
+        taskPool = const_cast<TaskPool*>(optionsTaskPool);
+    }
+    auto getTaskPool = [&]() {
+        if (!taskPool) taskPool = getOrCreateTaskPool ? getOrCreateTaskPool(buildOptions->numThreads) : osg2vsg::TaskPool::create(buildOptions->numThreads);
+        return taskPool;
+    };
+    if (buildOptions->parallelConversion) buildOptions->taskPool = getTaskPool();
+
+    uint32_t pipeline_cache_capacity = 0;
+    if (options && options->getValue(OSG::pipeline_cache_capacity, pipeline_cache_capacity))
+    {
+        pipelineCache->setCapacity(pipeline_cache_capacity);
+    }
+
+    std::string pipeline_manifest_filename;
+    if (options && options->getValue(OSG::read_pipeline_manifest, pipeline_manifest_filename))
+    {
+        // other conversions using the same cache block here until the prebuild has completed
+        std::call_once(pipelineCache->prebuildOnce, [&]() {
+            if (auto manifest = vsg::read_cast<osg2vsg::PipelineManifest>(pipeline_manifest_filename, options))
+            {
+                pipelineCache->prebuild(*manifest, options, getTaskPool());
+            }
+        });
+    }
 
     auto osg_scene = const_cast<osg::Node*>(&node);
 
@@ -118,6 +188,12 @@ vsg::ref_ptr<vsg::Node> osg2vsg::convert(const osg::Node& node, vsg::ref_ptr<con
     {
         osg2vsg::SceneBuilder sceneBuilder(buildOptions);
         auto vsg_scene = sceneBuilder.optimizeAndConvertToVsg(osg_scene, searchPaths);
+        reportStatistics(*buildOptions);
+
+        if (options && options->getValue(OSG::write_pipeline_manifest, pipeline_manifest_filename))
+        {
+            pipelineCache->writeManifest(pipeline_manifest_filename, options);
+        }
         return vsg_scene;
     }
     else
@@ -127,7 +203,14 @@ vsg::ref_ptr<vsg::Node> osg2vsg::convert(const osg::Node& node, vsg::ref_ptr<con
         osg2vsg::ConvertToVsg sceneBuilder(buildOptions, inheritedStateGroup);
 
         sceneBuilder.optimize(osg_scene);
+        sceneBuilder.setUpParallelConversion(osg_scene);
         auto vsg_scene = sceneBuilder.convert(osg_scene);
+        reportStatistics(*buildOptions);
+
+        if (options && options->getValue(OSG::write_pipeline_manifest, pipeline_manifest_filename))
+        {
+            pipelineCache->writeManifest(pipeline_manifest_filename, options);
+        }
 
         if (sceneBuilder.numOfPagedLOD > 0)
         {
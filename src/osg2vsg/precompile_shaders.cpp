@@ -0,0 +1,108 @@
+/* <editor-fold desc="MIT License">
+
+Copyright(c) 2026 Robert Osfield
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+</editor-fold> */
+
+// Build time tool that compiles all the permutations of the built-in fbx shaders reachable from PipelineCache to SPIR-V,
+// writing them out as a C++ table that is compiled into the library and looked up by assignPrecompiledSPIRV().
+
+#include "GeometryUtils.h"
+#include "ShaderUtils.h"
+
+#include "shaders/fbxshader_frag.cpp"
+#include "shaders/fbxshader_vert.cpp"
+
+#include <fstream>
+#include <iostream>
+
+using namespace osg2vsg;
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " output.cpp" << std::endl;
+        return 1;
+    }
+
+    std::map<uint64_t, vsg::ShaderModule::SPIRV> compiled;
+
+    auto shaderCompiler = vsg::ShaderCompiler::create();
+    if (shaderCompiler->supported())
+    {
+        const uint32_t geometryAttributes = NORMAL | TANGENT | COLOR | TEXCOORD0 | QUANTIZED | INSTANCE_MATRIX;
+
+        for (auto& stage : {fbxshader_vert(), fbxshader_frag()})
+        {
+            // many masks map to the same imported defines, so collect the distinct sets before compiling
+            std::set<std::set<std::string>> permutations;
+            for (uint32_t shaderModeMask = 0; shaderModeMask <= ALL_SHADER_MODE_MASK; ++shaderModeMask)
+            {
+                uint32_t geometryMask = 0;
+                do
+                {
+                    permutations.insert(filterImportedDefines(stage->module->source, createPSCDefineStrings(shaderModeMask, VERTEX | geometryMask)));
+                    geometryMask = (geometryMask - geometryAttributes) & geometryAttributes;
+                } while (geometryMask != 0);
+            }
+
+            for (auto& defines : permutations)
+            {
+                auto scs = vsg::ShaderCompileSettings::create();
+                scs->defines = defines;
+                stage->module->hints = scs;
+                stage->module->code.clear();
+
+                if (!shaderCompiler->compile(stage) || stage->module->code.empty())
+                {
+                    std::cerr << "Warning: unable to compile shader permutation, it will be compiled at runtime instead." << std::endl;
+                    continue;
+                }
+
+                compiled[computeShaderHash(*stage)] = stage->module->code;
+            }
+        }
+    }
+    else
+    {
+        std::cerr << "Warning: vsg built without shader compilation support, no shaders precompiled." << std::endl;
+    }
+
+    std::ofstream fout(argv[1]);
+    fout << "// generated by osg2vsg_precompile_shaders, do not edit.\n\n";
+    fout << "#include \"ShaderUtils.h\"\n\n";
+    fout << "namespace osg2vsg\n{\n";
+
+    size_t index = 0;
+    for (auto& [key, code] : compiled)
+    {
+        fout << "    static const uint32_t s_code_" << index++ << "[] = {";
+        for (size_t i = 0; i < code.size(); ++i)
+        {
+            if (i % 8 == 0) fout << "\n        ";
+            fout << code[i] << "u, ";
+        }
+        fout << "\n    };\n\n";
+    }
+
+    // the table needs at least one entry to be valid C++, an entry with null code is never returned as lookups require a matching key and non empty code
+    fout << "    extern const PrecompiledSPIRV precompiledSPIRV[] = {\n";
+    index = 0;
+    for (auto& [key, code] : compiled)
+    {
+        fout << "        {" << key << "ull, s_code_" << index++ << ", " << code.size() << "},\n";
+    }
+    if (compiled.empty()) fout << "        {0, nullptr, 0},\n";
+    fout << "    };\n\n";
+    fout << "    extern const size_t numPrecompiledSPIRV = " << compiled.size() << ";\n";
+    fout << "} // namespace osg2vsg\n";
+
+    return fout ? 0 : 1;
+}